@@ -3,6 +3,7 @@
 #include "Components/WSWeaponComponent.h"
 #include "WSWeapon.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
 
 UWSWeaponComponent::UWSWeaponComponent()
 {
@@ -76,7 +77,11 @@ bool UWSWeaponComponent::IsTargeting() const
 
 void UWSWeaponComponent::SetIsTargeting(const bool NewState)
 {
-	bIsTargeting = NewState;
+	if (bIsTargeting != NewState)
+	{
+		bIsTargeting = NewState;
+		MARK_PROPERTY_DIRTY_FROM_NAME(UWSWeaponComponent, bIsTargeting, this);
+	}
 }
 
 void UWSWeaponComponent::AddWeapon(AWSWeapon* Weapon)
@@ -85,6 +90,7 @@ void UWSWeaponComponent::AddWeapon(AWSWeapon* Weapon)
 	{
 		Weapon->OnEnterInventory(this);
 		Inventory.AddUnique(Weapon);
+		MARK_PROPERTY_DIRTY_FROM_NAME(UWSWeaponComponent, Inventory, this);
 	}
 }
 
@@ -110,6 +116,7 @@ void UWSWeaponComponent::RemoveWeapon(AWSWeapon* Weapon)
 	{
 		Weapon->OnLeaveInventory();
 		Inventory.RemoveSingle(Weapon);
+		MARK_PROPERTY_DIRTY_FROM_NAME(UWSWeaponComponent, Inventory, this);
 	}
 }
 
@@ -290,6 +297,7 @@ void UWSWeaponComponent::SetCurrentWeapon(AWSWeapon* NewWeapon, AWSWeapon* LastW
 	}
 
 	CurrentWeapon = NewWeapon;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UWSWeaponComponent, CurrentWeapon, this);
 
 	// equip new one
 	if (NewWeapon)
@@ -362,13 +370,20 @@ void UWSWeaponComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& O
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
+	// push model, marked dirty where changed
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
 	// only to local owner: weapon change requests are locally instigated, other clients don't need it
-	DOREPLIFETIME_CONDITION(UWSWeaponComponent, Inventory, COND_OwnerOnly);
+	Params.Condition = COND_OwnerOnly;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UWSWeaponComponent, Inventory, Params);
 
 	// everyone except local owner: flag change is locally instigated
-	DOREPLIFETIME_CONDITION(UWSWeaponComponent, bIsTargeting, COND_SkipOwner);
+	Params.Condition = COND_SkipOwner;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UWSWeaponComponent, bIsTargeting, Params);
 
 	// everyone
-	DOREPLIFETIME(UWSWeaponComponent, CurrentWeapon);
+	Params.Condition = COND_None;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UWSWeaponComponent, CurrentWeapon, Params);
 }
 
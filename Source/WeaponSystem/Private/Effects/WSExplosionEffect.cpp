@@ -3,8 +3,12 @@
 
 #include "Effects/WSExplosionEffect.h"
 #include "Components/PointLightComponent.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Engine/SimpleConstructionScript.h"
 #include "Kismet/GameplayStatics.h"
 #include "Sound/SoundCue.h"
+#include "Subsystems/WSDecalSubsystem.h"
+#include "Subsystems/WSExplosionLightSubsystem.h"
 
 // Sets default values
 AWSExplosionEffect::AWSExplosionEffect()
@@ -22,33 +26,113 @@ AWSExplosionEffect::AWSExplosionEffect()
 	ExplosionLight->CastShadows = false;
 	ExplosionLight->SetVisibleFlag(true);
 
+	SurfaceType = SurfaceType_Default;
+
 	ExplosionLightFadeOut = 0.2f;
+	ExplosionLightIntensity = 0.0f;
 }
 
-void AWSExplosionEffect::BeginPlay()
+void AWSExplosionEffect::PlayExplosion(UWorld* World, TSubclassOf<AWSExplosionEffect> EffectClass, const FTransform& SpawnTransform, const FHitResult& SurfaceHit,
+	EPhysicalSurface SurfaceType)
 {
-	Super::BeginPlay();
+	if (World == nullptr || EffectClass == nullptr)
+	{
+		return;
+	}
+
+	// blueprint additions need a live actor
+	const bool bNeedsActor = !CanPlayWithoutActor(EffectClass) || World->GetSubsystem<UWSExplosionLightSubsystem>() == nullptr;
+
+	if (!bNeedsActor)
+	{
+		SpawnEffects(World, EffectClass->GetDefaultObject<AWSExplosionEffect>(), SpawnTransform, SurfaceHit);
+		return;
+	}
 
-	if (ExplosionFX)
+	AWSExplosionEffect* const EffectActor = World->SpawnActorDeferred<AWSExplosionEffect>(EffectClass, SpawnTransform);
+	if (EffectActor)
 	{
-		UGameplayStatics::SpawnEmitterAtLocation(this, ExplosionFX, GetActorLocation(), GetActorRotation());
+		EffectActor->SurfaceHit = SurfaceHit;
+		EffectActor->SurfaceType = SurfaceType;
+		UGameplayStatics::FinishSpawningActor(EffectActor, SpawnTransform);
 	}
+}
+
+bool AWSExplosionEffect::CanPlayWithoutActor(TSubclassOf<AWSExplosionEffect> EffectClass)
+{
+	for (const UClass* Class = EffectClass; Class && !Class->HasAnyClassFlags(CLASS_Native); Class = Class->GetSuperClass())
+	{
+		const UBlueprintGeneratedClass* BlueprintClass = Cast<UBlueprintGeneratedClass>(Class);
+		if (BlueprintClass == nullptr)
+		{
+			return false;
+		}
+
+		// event graph, construction script, added components and timelines are lost without an actor
+		const bool bHasScript = BlueprintClass->UberGraphFunction != nullptr
+			|| BlueprintClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AActor, UserConstructionScript));
+		const bool bHasComponents = (BlueprintClass->SimpleConstructionScript && BlueprintClass->SimpleConstructionScript->GetAllNodes().Num() > 0)
+			|| BlueprintClass->Timelines.Num() > 0;
+
+		if (bHasScript || bHasComponents)
+		{
+			return false;
+		}
+	}
+
+	return EffectClass != nullptr;
+}
+
+bool AWSExplosionEffect::SpawnEffects(UWorld* World, const AWSExplosionEffect* Settings, const FTransform& SpawnTransform, const FHitResult& SurfaceHit)
+{
+	const FVector Location = SpawnTransform.GetLocation();
 
-	if (ExplosionSound)
+	if (Settings->ExplosionFX)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, ExplosionSound, GetActorLocation());
+		UGameplayStatics::SpawnEmitterAtLocation(World, Settings->ExplosionFX, Location, SpawnTransform.Rotator());
 	}
 
-	if (Decal.DecalMaterial)
+	if (Settings->ExplosionSound)
+	{
+		UGameplayStatics::PlaySoundAtLocation(World, Settings->ExplosionSound, Location);
+	}
+
+	UWSDecalSubsystem* Decals = World->GetSubsystem<UWSDecalSubsystem>();
+	if (Settings->Decal.DecalMaterial && Decals)
 	{
 		FRotator RandomDecalRotation = SurfaceHit.ImpactNormal.Rotation();
 		RandomDecalRotation.Roll = FMath::FRandRange(-180.0f, 180.0f);
 
-		UGameplayStatics::SpawnDecalAttached(Decal.DecalMaterial, FVector(Decal.DecalSize, Decal.DecalSize, 1.0f),
+		Decals->SpawnDecal(Settings->Decal.DecalMaterial, FVector(Settings->Decal.DecalSize, Settings->Decal.DecalSize, 1.0f),
 			SurfaceHit.Component.Get(), SurfaceHit.BoneName,
-			SurfaceHit.ImpactPoint, RandomDecalRotation, EAttachLocation::KeepWorldPosition,
-			Decal.LifeSpan);
+			SurfaceHit.ImpactPoint, RandomDecalRotation, Settings->Decal.LifeSpan);
 	}
+
+	// light may be dropped by the cap, that is fine
+	UWSExplosionLightSubsystem* Lights = World->GetSubsystem<UWSExplosionLightSubsystem>();
+	if (Lights)
+	{
+		Lights->SpawnLight(Settings->GetClass(), Location);
+		return true;
+	}
+
+	return false;
+}
+
+void AWSExplosionEffect::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (SpawnEffects(GetWorld(), this, GetActorTransform(), SurfaceHit))
+	{
+		// light is faded by explosion light manager
+		ExplosionLight->SetVisibility(false);
+		SetActorTickEnabled(false);
+		SetLifeSpan(0.1f);
+		return;
+	}
+
+	ExplosionLightIntensity = ExplosionLight->Intensity;
 }
 
 void AWSExplosionEffect::Tick(float DeltaSeconds)
@@ -61,9 +145,7 @@ void AWSExplosionEffect::Tick(float DeltaSeconds)
 	if (TimeRemaining > 0)
 	{
 		const float FadeAlpha = 1.0f - FMath::Square(TimeRemaining / ExplosionLightFadeOut);
-
-		UPointLightComponent* DefLight = Cast<UPointLightComponent>(GetClass()->GetDefaultSubobjectByName(ExplosionLightComponentName));
-		ExplosionLight->SetIntensity(DefLight->Intensity * FadeAlpha);
+		ExplosionLight->SetIntensity(ExplosionLightIntensity * FadeAlpha);
 	}
 	else
 	{
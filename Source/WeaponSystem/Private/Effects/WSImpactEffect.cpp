@@ -5,24 +5,39 @@
 #include "Kismet/GameplayStatics.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
 #include "Sound/SoundCue.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Effects/WSSurfaceEffectData.h"
+#include "Subsystems/WSDecalSubsystem.h"
 
 AWSImpactEffect::AWSImpactEffect()
 {
 	SetAutoDestroyWhenFinished(true);
+	SurfaceType = SurfaceType_Default;
+	bPooled = false;
 }
 
 void AWSImpactEffect::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
 
+	if (!bPooled)
+	{
+		ActivateEffect();
+	}
+}
+
+void AWSImpactEffect::ActivateEffect()
+{
 	UPhysicalMaterial* HitPhysMat = SurfaceHit.PhysMaterial.Get();
-	const EPhysicalSurface HitSurfaceType = UPhysicalMaterial::DetermineSurfaceType(HitPhysMat);
+	const EPhysicalSurface HitSurfaceType = (HitPhysMat == nullptr && SurfaceType != SurfaceType_Default) ? SurfaceType.GetValue() : UPhysicalMaterial::DetermineSurfaceType(HitPhysMat);
 
 	// show particles
 	UParticleSystem* ImpactFX = GetImpactFX(HitSurfaceType);
 	if (ImpactFX)
 	{
-		UGameplayStatics::SpawnEmitterAtLocation(this, ImpactFX, GetActorLocation(), GetActorRotation());
+		// pooled effects keep the particles until reset
+		const EPSCPoolMethod PoolMethod = bPooled ? EPSCPoolMethod::ManualRelease : EPSCPoolMethod::None;
+		SpawnedFX = UGameplayStatics::SpawnEmitterAtLocation(this, ImpactFX, GetActorLocation(), GetActorRotation(), FVector(1.0f), true, PoolMethod);
 	}
 
 	// play sound
@@ -32,20 +47,38 @@ void AWSImpactEffect::PostInitializeComponents()
 		UGameplayStatics::PlaySoundAtLocation(this, ImpactSound, GetActorLocation());
 	}
 
-	if (DefaultDecal.DecalMaterial)
+	const FDecalData& ImpactDecal = GetImpactDecal(HitSurfaceType);
+	UWSDecalSubsystem* Decals = GetWorld()->GetSubsystem<UWSDecalSubsystem>();
+	if (ImpactDecal.DecalMaterial && Decals)
 	{
 		FRotator RandomDecalRotation = SurfaceHit.ImpactNormal.Rotation();
 		RandomDecalRotation.Roll = FMath::FRandRange(-180.0f, 180.0f);
 
-		UGameplayStatics::SpawnDecalAttached(DefaultDecal.DecalMaterial, FVector(1.0f, DefaultDecal.DecalSize, DefaultDecal.DecalSize),
+		Decals->SpawnDecal(ImpactDecal.DecalMaterial, FVector(1.0f, ImpactDecal.DecalSize, ImpactDecal.DecalSize),
 			SurfaceHit.Component.Get(), SurfaceHit.BoneName,
-			SurfaceHit.ImpactPoint, RandomDecalRotation, EAttachLocation::KeepWorldPosition,
-			DefaultDecal.LifeSpan);
+			SurfaceHit.ImpactPoint, RandomDecalRotation, ImpactDecal.LifeSpan);
 	}
 }
 
+void AWSImpactEffect::ResetEffect()
+{
+	if (UParticleSystemComponent* FX = SpawnedFX.Get())
+	{
+		FX->ReleaseToPool();
+	}
+
+	SpawnedFX.Reset();
+	SurfaceHit.Reset(1.0f, false);
+	SurfaceType = SurfaceType_Default;
+}
+
 UParticleSystem* AWSImpactEffect::GetImpactFX(TEnumAsByte<EPhysicalSurface> SurfaceType) const
 {
+	if (SurfaceEffects)
+	{
+		return SurfaceEffects->GetImpactFX(SurfaceType);
+	}
+
 	UParticleSystem* ImpactFX = nullptr;
 
 	switch (SurfaceType)
@@ -66,6 +99,11 @@ UParticleSystem* AWSImpactEffect::GetImpactFX(TEnumAsByte<EPhysicalSurface> Surf
 
 USoundCue* AWSImpactEffect::GetImpactSound(TEnumAsByte<EPhysicalSurface> SurfaceType) const
 {
+	if (SurfaceEffects)
+	{
+		return SurfaceEffects->GetImpactSound(SurfaceType);
+	}
+
 	USoundCue* ImpactSound = nullptr;
 
 	switch (SurfaceType)
@@ -84,3 +122,7 @@ USoundCue* AWSImpactEffect::GetImpactSound(TEnumAsByte<EPhysicalSurface> Surface
 	return ImpactSound;
 }
 
+const FDecalData& AWSImpactEffect::GetImpactDecal(TEnumAsByte<EPhysicalSurface> SurfaceType) const
+{
+	return SurfaceEffects ? SurfaceEffects->GetImpactDecal(SurfaceType) : DefaultDecal;
+}
@@ -0,0 +1,22 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Effects/WSSurfaceEffectData.h"
+#include "Sound/SoundCue.h"
+
+UParticleSystem* UWSSurfaceEffectData::GetImpactFX(EPhysicalSurface SurfaceType) const
+{
+	UParticleSystem* ImpactFX = GetSurfaceEffect(SurfaceType).FX;
+	return ImpactFX ? ImpactFX : Surfaces[SurfaceType_Default].FX.Get();
+}
+
+USoundCue* UWSSurfaceEffectData::GetImpactSound(EPhysicalSurface SurfaceType) const
+{
+	USoundCue* ImpactSound = GetSurfaceEffect(SurfaceType).Sound;
+	return ImpactSound ? ImpactSound : Surfaces[SurfaceType_Default].Sound.Get();
+}
+
+const FDecalData& UWSSurfaceEffectData::GetImpactDecal(EPhysicalSurface SurfaceType) const
+{
+	const FDecalData& ImpactDecal = GetSurfaceEffect(SurfaceType).Decal;
+	return ImpactDecal.DecalMaterial ? ImpactDecal : Surfaces[SurfaceType_Default].Decal;
+}
@@ -0,0 +1,154 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSDecalSubsystem.h"
+#include "WeaponSystem.h"
+#include "Components/DecalComponent.h"
+#include "GameFramework/WorldSettings.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live Decals"), STAT_WSLiveDecals, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Evicted Decals"), STAT_WSEvictedDecals, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Merged Decals"), STAT_WSMergedDecals, STATGROUP_WeaponSystem);
+
+void UWSDecalSubsystem::Deinitialize()
+{
+	LiveDecals.Empty();
+	FreeDecals.Empty();
+	DecalComponents.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UWSDecalSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UWSDecalSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (int32 LiveIndex = LiveDecals.Num() - 1; LiveIndex >= 0; LiveIndex--)
+	{
+		const FLiveDecal& LiveDecal = LiveDecals[LiveIndex];
+		const bool bExpired = LiveDecal.ExpireTime > 0.0 && LiveDecal.ExpireTime <= Now;
+		const bool bParentDestroyed = LiveDecal.bAttached && !LiveDecal.AttachParent.IsValid();
+		if (bExpired || bParentDestroyed)
+		{
+			ReleaseDecal(LiveIndex);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_WSLiveDecals, LiveDecals.Num());
+}
+
+TStatId UWSDecalSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWSDecalSubsystem, STATGROUP_Tickables);
+}
+
+UDecalComponent* UWSDecalSubsystem::SpawnDecal(UMaterialInterface* DecalMaterial, const FVector& DecalSize, USceneComponent* AttachToComponent, FName AttachPointName,
+	const FVector& Location, const FRotator& Rotation, float LifeSpan)
+{
+	if (DecalMaterial == nullptr || MaxDecals <= 0)
+	{
+		return nullptr;
+	}
+
+	const double ExpireTime = LifeSpan > 0.0f ? GetWorld()->GetTimeSeconds() + LifeSpan : 0.0;
+
+	// merge with a recent decal of the same material on the same component
+	const float MergeDistanceSq = FMath::Square(MergeDistance);
+	for (int32 LiveIndex = LiveDecals.Num() - 1; LiveIndex >= 0; LiveIndex--)
+	{
+		FLiveDecal& LiveDecal = LiveDecals[LiveIndex];
+		UDecalComponent* DecalComponent = DecalComponents[LiveDecal.DecalIndex];
+		if (IsValid(DecalComponent) &&
+			LiveDecal.bAttached == (AttachToComponent != nullptr) &&
+			LiveDecal.AttachParent.Get() == AttachToComponent &&
+			DecalComponent->GetDecalMaterial() == DecalMaterial &&
+			FVector::DistSquared(LiveDecal.Location, Location) <= MergeDistanceSq)
+		{
+			INC_DWORD_STAT(STAT_WSMergedDecals);
+
+			// refresh and move to the most recently used end
+			FLiveDecal MergedDecal = LiveDecal;
+			MergedDecal.ExpireTime = ExpireTime;
+			LiveDecals.RemoveAt(LiveIndex, 1, false);
+			LiveDecals.Add(MergedDecal);
+
+			return DecalComponent;
+		}
+	}
+
+	const int32 DecalIndex = AcquireDecal();
+	UDecalComponent* DecalComponent = DecalComponents[DecalIndex];
+
+	DecalComponent->SetDecalMaterial(DecalMaterial);
+	DecalComponent->DecalSize = DecalSize;
+	DecalComponent->SetWorldLocationAndRotation(Location, Rotation);
+	if (AttachToComponent)
+	{
+		DecalComponent->AttachToComponent(AttachToComponent, FAttachmentTransformRules::KeepWorldTransform, AttachPointName);
+	}
+	DecalComponent->SetVisibility(true);
+	DecalComponent->MarkRenderStateDirty();
+
+	FLiveDecal& LiveDecal = LiveDecals.AddDefaulted_GetRef();
+	LiveDecal.DecalIndex = DecalIndex;
+	LiveDecal.AttachParent = AttachToComponent;
+	LiveDecal.bAttached = AttachToComponent != nullptr;
+	LiveDecal.Location = Location;
+	LiveDecal.ExpireTime = ExpireTime;
+
+	return DecalComponent;
+}
+
+int32 UWSDecalSubsystem::AcquireDecal()
+{
+	if (FreeDecals.Num() == 0)
+	{
+		if (DecalComponents.Num() < MaxDecals)
+		{
+			return DecalComponents.Add(CreateDecalComponent());
+		}
+
+		// budget reached, reuse the least recently used decal
+		INC_DWORD_STAT(STAT_WSEvictedDecals);
+		ReleaseDecal(0);
+	}
+
+	const int32 DecalIndex = FreeDecals.Pop(false);
+
+	// component could be destroyed together with the actor it was attached to
+	if (!IsValid(DecalComponents[DecalIndex]))
+	{
+		DecalComponents[DecalIndex] = CreateDecalComponent();
+	}
+
+	return DecalIndex;
+}
+
+UDecalComponent* UWSDecalSubsystem::CreateDecalComponent() const
+{
+	UDecalComponent* DecalComponent = NewObject<UDecalComponent>(GetWorld()->GetWorldSettings());
+	DecalComponent->bAllowAnyoneToDestroyMe = true;
+	DecalComponent->RegisterComponentWithWorld(GetWorld());
+
+	return DecalComponent;
+}
+
+void UWSDecalSubsystem::ReleaseDecal(int32 LiveIndex)
+{
+	const int32 DecalIndex = LiveDecals[LiveIndex].DecalIndex;
+	LiveDecals.RemoveAt(LiveIndex, 1, false);
+
+	UDecalComponent* DecalComponent = DecalComponents[DecalIndex];
+	if (IsValid(DecalComponent))
+	{
+		DecalComponent->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+		DecalComponent->SetVisibility(false);
+	}
+
+	FreeDecals.Add(DecalIndex);
+}
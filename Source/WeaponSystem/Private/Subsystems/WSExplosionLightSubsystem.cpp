@@ -0,0 +1,212 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSExplosionLightSubsystem.h"
+#include "WeaponSystem.h"
+#include "Effects/WSExplosionEffect.h"
+#include "Components/PointLightComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/WorldSettings.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Active Explosion Lights"), STAT_WSActiveExplosionLights, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Evicted Explosion Lights"), STAT_WSEvictedExplosionLights, STATGROUP_WeaponSystem);
+
+void UWSExplosionLightSubsystem::Deinitialize()
+{
+	LightSettings.Empty();
+	LightComponents.Empty();
+	FreeLights.Empty();
+	ActiveLights.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UWSExplosionLightSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UWSExplosionLightSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWSExplosionLightSubsystem, STATGROUP_Tickables);
+}
+
+bool UWSExplosionLightSubsystem::IsEnabled() const
+{
+	return GetWorld()->GetNetMode() != NM_DedicatedServer;
+}
+
+const FWSExplosionLightSettings* UWSExplosionLightSubsystem::GetLightSettings(TSubclassOf<AWSExplosionEffect> EffectClass)
+{
+	if (const FWSExplosionLightSettings* Settings = LightSettings.Find(EffectClass))
+	{
+		return Settings;
+	}
+
+	const AWSExplosionEffect* DefaultEffect = EffectClass->GetDefaultObject<AWSExplosionEffect>();
+	const UPointLightComponent* DefaultLight = DefaultEffect->GetExplosionLight();
+	if (DefaultLight == nullptr)
+	{
+		return nullptr;
+	}
+
+	FWSExplosionLightSettings& Settings = LightSettings.Add(EffectClass);
+	Settings.Intensity = DefaultLight->Intensity;
+	Settings.AttenuationRadius = DefaultLight->AttenuationRadius;
+	Settings.FadeOut = DefaultEffect->ExplosionLightFadeOut;
+	Settings.LightColor = DefaultLight->GetLightColor();
+	Settings.bUseInverseSquaredFalloff = DefaultLight->bUseInverseSquaredFalloff;
+
+	return &Settings;
+}
+
+float UWSExplosionLightSubsystem::GetLightImportance(const FWSActiveExplosionLight& Light, const FVector& ViewLocation, double Now)
+{
+	// fading intensity is zero at spawn, score new and old lights the same way by what is left of them
+	const float TimeRemaining = FMath::Max(0.0f, Light.FadeOut - static_cast<float>(Now - Light.StartTime));
+	const float LifeAlpha = Light.FadeOut > 0.0f ? TimeRemaining / Light.FadeOut : 0.0f;
+
+	return Light.Intensity * LifeAlpha * FMath::Square(Light.AttenuationRadius) / FMath::Max(FVector::DistSquared(Light.Location, ViewLocation), 1.0);
+}
+
+int32 UWSExplosionLightSubsystem::FindLightToEvict(TConstArrayView<FWSActiveExplosionLight> Lights, const FWSActiveExplosionLight& NewLight, const FVector& ViewLocation, double Now)
+{
+	int32 EvictIndex = INDEX_NONE;
+	float EvictImportance = GetLightImportance(NewLight, ViewLocation, Now);
+	for (int32 ActiveIndex = 0; ActiveIndex < Lights.Num(); ActiveIndex++)
+	{
+		const float Importance = GetLightImportance(Lights[ActiveIndex], ViewLocation, Now);
+		if (Importance < EvictImportance)
+		{
+			EvictIndex = ActiveIndex;
+			EvictImportance = Importance;
+		}
+	}
+
+	return EvictIndex;
+}
+
+bool UWSExplosionLightSubsystem::SpawnLight(TSubclassOf<AWSExplosionEffect> EffectClass, const FVector& Location)
+{
+	if (EffectClass == nullptr || !IsEnabled() || MaxActiveLights <= 0)
+	{
+		return false;
+	}
+
+	const FWSExplosionLightSettings* Settings = GetLightSettings(EffectClass);
+	if (Settings == nullptr || Settings->FadeOut <= 0.0f)
+	{
+		return false;
+	}
+
+	FWSActiveExplosionLight NewLight;
+	NewLight.LightIndex = INDEX_NONE;
+	NewLight.Intensity = Settings->Intensity;
+	NewLight.AttenuationRadius = Settings->AttenuationRadius;
+	NewLight.FadeOut = Settings->FadeOut;
+	NewLight.StartTime = GetWorld()->GetTimeSeconds();
+	NewLight.Location = Location;
+
+	if (ActiveLights.Num() >= MaxActiveLights)
+	{
+		FVector ViewLocation = Location;
+		if (const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController())
+		{
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		}
+
+		const int32 EvictIndex = FindLightToEvict(ActiveLights, NewLight, ViewLocation, NewLight.StartTime);
+
+		// new light is the least important one
+		if (EvictIndex == INDEX_NONE)
+		{
+			return false;
+		}
+
+		INC_DWORD_STAT(STAT_WSEvictedExplosionLights);
+		ReleaseLight(EvictIndex);
+	}
+
+	const int32 LightIndex = AcquireLight();
+	UPointLightComponent* LightComponent = LightComponents[LightIndex];
+	LightComponent->SetWorldLocation(Location);
+	LightComponent->SetAttenuationRadius(Settings->AttenuationRadius);
+	LightComponent->SetLightColor(Settings->LightColor);
+	LightComponent->bUseInverseSquaredFalloff = Settings->bUseInverseSquaredFalloff;
+	LightComponent->SetIntensity(0.0f);
+	LightComponent->SetVisibility(true);
+
+	NewLight.LightIndex = LightIndex;
+	ActiveLights.Add(NewLight);
+
+	return true;
+}
+
+void UWSExplosionLightSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SET_DWORD_STAT(STAT_WSActiveExplosionLights, ActiveLights.Num());
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (int32 ActiveIndex = ActiveLights.Num() - 1; ActiveIndex >= 0; ActiveIndex--)
+	{
+		const FWSActiveExplosionLight& ActiveLight = ActiveLights[ActiveIndex];
+		UPointLightComponent* LightComponent = LightComponents[ActiveLight.LightIndex];
+		const float TimeRemaining = FMath::Max(0.0f, ActiveLight.FadeOut - static_cast<float>(Now - ActiveLight.StartTime));
+
+		if (TimeRemaining > 0 && IsValid(LightComponent))
+		{
+			const float FadeAlpha = 1.0f - FMath::Square(TimeRemaining / ActiveLight.FadeOut);
+			LightComponent->SetIntensity(ActiveLight.Intensity * FadeAlpha);
+		}
+		else
+		{
+			ReleaseLight(ActiveIndex);
+		}
+	}
+}
+
+int32 UWSExplosionLightSubsystem::AcquireLight()
+{
+	if (FreeLights.Num() == 0)
+	{
+		return LightComponents.Add(CreateLightComponent());
+	}
+
+	const int32 LightIndex = FreeLights.Pop(false);
+
+	// component could be destroyed together with world settings on level change
+	if (!IsValid(LightComponents[LightIndex]))
+	{
+		LightComponents[LightIndex] = CreateLightComponent();
+	}
+
+	return LightIndex;
+}
+
+void UWSExplosionLightSubsystem::ReleaseLight(int32 ActiveIndex)
+{
+	const int32 LightIndex = ActiveLights[ActiveIndex].LightIndex;
+	ActiveLights.RemoveAtSwap(ActiveIndex, 1, false);
+
+	UPointLightComponent* LightComponent = LightComponents[LightIndex];
+	if (IsValid(LightComponent))
+	{
+		LightComponent->SetVisibility(false);
+	}
+
+	FreeLights.Add(LightIndex);
+}
+
+UPointLightComponent* UWSExplosionLightSubsystem::CreateLightComponent() const
+{
+	UPointLightComponent* LightComponent = NewObject<UPointLightComponent>(GetWorld()->GetWorldSettings());
+	LightComponent->bAllowAnyoneToDestroyMe = true;
+	LightComponent->CastShadows = false;
+	LightComponent->SetMobility(EComponentMobility::Movable);
+	LightComponent->SetVisibility(false);
+	LightComponent->RegisterComponentWithWorld(GetWorld());
+
+	return LightComponent;
+}
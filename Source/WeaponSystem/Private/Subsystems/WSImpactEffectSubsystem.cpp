@@ -0,0 +1,177 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSImpactEffectSubsystem.h"
+#include "WeaponSystem.h"
+#include "Effects/WSImpactEffect.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Pool Hits"), STAT_WSImpactPoolHits, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Pool Misses"), STAT_WSImpactPoolMisses, STATGROUP_WeaponSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Active Impact Effects"), STAT_WSActiveImpactEffects, STATGROUP_WeaponSystem);
+
+void UWSImpactEffectSubsystem::Deinitialize()
+{
+	ActiveEffects.Empty();
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UWSImpactEffectSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UWSImpactEffectSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (IsPoolingEnabled())
+	{
+		for (const TSoftClassPtr<AWSImpactEffect>& Template : PrewarmTemplates)
+		{
+			PrewarmPool(Template.LoadSynchronous());
+		}
+	}
+}
+
+void UWSImpactEffectSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// active effects are ordered by release time
+	const double Now = GetWorld()->GetTimeSeconds();
+	int32 NumReleased = 0;
+	while (NumReleased < ActiveEffects.Num() && ActiveEffects[NumReleased].ReleaseTime <= Now)
+	{
+		if (AWSImpactEffect* Effect = ActiveEffects[NumReleased].Effect.Get())
+		{
+			ReturnToPool(Effect);
+		}
+		NumReleased++;
+	}
+
+	if (NumReleased > 0)
+	{
+		ActiveEffects.RemoveAt(0, NumReleased, false);
+	}
+
+	SET_DWORD_STAT(STAT_WSActiveImpactEffects, ActiveEffects.Num());
+}
+
+TStatId UWSImpactEffectSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWSImpactEffectSubsystem, STATGROUP_Tickables);
+}
+
+AWSImpactEffect* UWSImpactEffectSubsystem::SpawnImpactEffect(TSubclassOf<AWSImpactEffect> Template, const FTransform& Transform, const FHitResult& SurfaceHit, EPhysicalSurface SurfaceType)
+{
+	if (Template == nullptr)
+	{
+		return nullptr;
+	}
+
+	AWSImpactEffect* Effect = nullptr;
+	if (IsPoolingEnabled())
+	{
+		FWSImpactEffectPool& Pool = Pools.FindOrAdd(Template);
+		while (Pool.FreeEffects.Num() > 0)
+		{
+			// skip effects destroyed outside of the pool
+			AWSImpactEffect* FreeEffect = Pool.FreeEffects.Pop(false);
+			if (IsValid(FreeEffect))
+			{
+				Effect = FreeEffect;
+				break;
+			}
+			Pool.NumCreated--;
+		}
+
+		if (Effect)
+		{
+			NumPoolHits++;
+			INC_DWORD_STAT(STAT_WSImpactPoolHits);
+		}
+		else
+		{
+			NumPoolMisses++;
+			INC_DWORD_STAT(STAT_WSImpactPoolMisses);
+
+			if (Pool.NumCreated < MaxPoolSize)
+			{
+				Effect = CreatePooledEffect(Template, Pool);
+			}
+		}
+	}
+
+	if (Effect == nullptr)
+	{
+		// pool is full, spawn self destroying effect
+		AWSImpactEffect* SpawnedEffect = GetWorld()->SpawnActorDeferred<AWSImpactEffect>(Template, Transform);
+		if (SpawnedEffect)
+		{
+			SpawnedEffect->SurfaceHit = SurfaceHit;
+			SpawnedEffect->SurfaceType = SurfaceType;
+			UGameplayStatics::FinishSpawningActor(SpawnedEffect, Transform);
+		}
+		return SpawnedEffect;
+	}
+
+	Effect->SetActorTransform(Transform);
+	Effect->SurfaceHit = SurfaceHit;
+	Effect->SurfaceType = SurfaceType;
+	Effect->ActivateEffect();
+
+	ActiveEffects.Add({ Effect, GetWorld()->GetTimeSeconds() + PooledLifeSpan });
+
+	return Effect;
+}
+
+void UWSImpactEffectSubsystem::PrewarmPool(TSubclassOf<AWSImpactEffect> Template, int32 Count)
+{
+	if (Template == nullptr || !IsPoolingEnabled())
+	{
+		return;
+	}
+
+	const int32 NumEffects = FMath::Min(Count == INDEX_NONE ? PrewarmCount : Count, MaxPoolSize);
+
+	FWSImpactEffectPool& Pool = Pools.FindOrAdd(Template);
+	while (Pool.NumCreated < NumEffects)
+	{
+		AWSImpactEffect* Effect = CreatePooledEffect(Template, Pool);
+		if (Effect == nullptr)
+		{
+			break;
+		}
+
+		Pool.FreeEffects.Add(Effect);
+	}
+}
+
+bool UWSImpactEffectSubsystem::IsPoolingEnabled() const
+{
+	return GetWorld()->GetNetMode() != NM_DedicatedServer;
+}
+
+AWSImpactEffect* UWSImpactEffectSubsystem::CreatePooledEffect(TSubclassOf<AWSImpactEffect> Template, FWSImpactEffectPool& Pool)
+{
+	AWSImpactEffect* Effect = GetWorld()->SpawnActorDeferred<AWSImpactEffect>(Template, FTransform::Identity);
+	if (Effect)
+	{
+		// pooled effect is activated explicitly and never destroys itself
+		Effect->bPooled = true;
+		Effect->SetAutoDestroyWhenFinished(false);
+		UGameplayStatics::FinishSpawningActor(Effect, FTransform::Identity);
+
+		Pool.NumCreated++;
+	}
+
+	return Effect;
+}
+
+void UWSImpactEffectSubsystem::ReturnToPool(AWSImpactEffect* Effect)
+{
+	Effect->ResetEffect();
+	Pools.FindOrAdd(Effect->GetClass()).FreeEffects.Add(Effect);
+}
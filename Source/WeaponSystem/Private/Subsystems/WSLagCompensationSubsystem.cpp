@@ -0,0 +1,241 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSLagCompensationSubsystem.h"
+#include "WeaponSystem.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/SpectatorPawn.h"
+
+void UWSLagCompensationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	MaxTrackedActors = FMath::Max(1, MaxTrackedActors);
+	HistoryLength = FMath::Max(2, HistoryLength);
+
+	// whole history is allocated once
+	SlotActors.SetNum(MaxTrackedActors);
+	SlotKeys.SetNum(MaxTrackedActors);
+	SlotStartTimes.SetNumZeroed(MaxTrackedActors);
+	FrameTimes.SetNumZeroed(HistoryLength);
+	BoxCenters.SetNumZeroed(HistoryLength * MaxTrackedActors);
+	BoxExtents.SetNumZeroed(HistoryLength * MaxTrackedActors);
+	ActorSlots.Reserve(MaxTrackedActors);
+
+	FreeSlots.Reserve(MaxTrackedActors);
+	for (int32 Slot = MaxTrackedActors - 1; Slot >= 0; Slot--)
+	{
+		FreeSlots.Add(Slot);
+	}
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UWSLagCompensationSubsystem::OnActorSpawned));
+}
+
+void UWSLagCompensationSubsystem::Deinitialize()
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+
+	Super::Deinitialize();
+}
+
+bool UWSLagCompensationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UWSLagCompensationSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (IsRecording())
+	{
+		for (TActorIterator<APawn> It(&InWorld); It; ++It)
+		{
+			OnActorSpawned(*It);
+		}
+	}
+}
+
+void UWSLagCompensationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	NewestFrame = (NewestFrame + 1) % HistoryLength;
+	NumFrames = FMath::Min(NumFrames + 1, HistoryLength);
+	FrameTimes[NewestFrame] = GetWorld()->GetTimeSeconds();
+
+	const int32 FrameStart = GetBufferIndex(NewestFrame, 0);
+	for (int32 Slot = 0; Slot < MaxTrackedActors; Slot++)
+	{
+		const AActor* Actor = SlotActors[Slot].Get();
+		if (Actor == nullptr)
+		{
+			// release slots of destroyed actors
+			if (!SlotActors[Slot].IsExplicitlyNull())
+			{
+				ReleaseSlot(Slot);
+			}
+			continue;
+		}
+
+		// cached root bounds, no component walk
+		if (const USceneComponent* Root = Actor->GetRootComponent())
+		{
+			BoxCenters[FrameStart + Slot] = FVector3f(Root->Bounds.Origin);
+			BoxExtents[FrameStart + Slot] = FVector3f(Root->Bounds.BoxExtent);
+		}
+	}
+}
+
+TStatId UWSLagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWSLagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+bool UWSLagCompensationSubsystem::RegisterActor(AActor* Actor)
+{
+	if (Actor == nullptr)
+	{
+		return false;
+	}
+
+	if (ActorSlots.Contains(Actor))
+	{
+		return true;
+	}
+
+	if (FreeSlots.Num() == 0)
+	{
+		UE_LOG(LogWeaponSystem, Verbose, TEXT("Lag compensation history is full, %s is not tracked"), *GetNameSafe(Actor));
+		return false;
+	}
+
+	const int32 Slot = FreeSlots.Pop();
+	SlotActors[Slot] = Actor;
+	SlotKeys[Slot] = Actor;
+	SlotStartTimes[Slot] = GetWorld()->GetTimeSeconds();
+	ActorSlots.Add(Actor, Slot);
+
+	return true;
+}
+
+void UWSLagCompensationSubsystem::UnregisterActor(AActor* Actor)
+{
+	if (const int32* Slot = ActorSlots.Find(Actor))
+	{
+		ReleaseSlot(*Slot);
+	}
+}
+
+bool UWSLagCompensationSubsystem::GetRewoundBox(const AActor* Actor, double Time, FBox& OutBox) const
+{
+	const int32* SlotPtr = ActorSlots.Find(Actor);
+	if (SlotPtr == nullptr || NumFrames == 0)
+	{
+		return false;
+	}
+
+	const int32 Slot = *SlotPtr;
+	const double SlotStartTime = SlotStartTimes[Slot];
+	if (FrameTimes[NewestFrame] < SlotStartTime)
+	{
+		// registered after the last recorded frame
+		return false;
+	}
+
+	int32 NewerFrame = NewestFrame;
+	if (Time < FrameTimes[NewerFrame])
+	{
+		// find frames around the requested time, going back from the newest one
+		for (int32 Step = 1; Step < NumFrames; Step++)
+		{
+			const int32 OlderFrame = (NewestFrame - Step + HistoryLength) % HistoryLength;
+			const double OlderTime = FrameTimes[OlderFrame];
+			if (OlderTime < SlotStartTime)
+			{
+				break;
+			}
+
+			if (Time >= OlderTime)
+			{
+				const double FrameSpan = FrameTimes[NewerFrame] - OlderTime;
+				const float Alpha = FrameSpan > UE_SMALL_NUMBER ? static_cast<float>((Time - OlderTime) / FrameSpan) : 0.0f;
+
+				const int32 OlderIndex = GetBufferIndex(OlderFrame, Slot);
+				const int32 NewerIndex = GetBufferIndex(NewerFrame, Slot);
+				const FVector Center = FVector(FMath::Lerp(BoxCenters[OlderIndex], BoxCenters[NewerIndex], Alpha));
+				const FVector Extent = FVector(FMath::Lerp(BoxExtents[OlderIndex], BoxExtents[NewerIndex], Alpha));
+
+				OutBox = FBox::BuildAABB(Center, Extent);
+				return true;
+			}
+
+			NewerFrame = OlderFrame;
+		}
+	}
+
+	// out of recorded range, use the closest frame
+	const int32 Index = GetBufferIndex(NewerFrame, Slot);
+	OutBox = FBox::BuildAABB(FVector(BoxCenters[Index]), FVector(BoxExtents[Index]));
+	return true;
+}
+
+EWSRewindHitResult UWSLagCompensationSubsystem::ValidateHit(const AActor* Actor, double Time, const FVector& TraceStart, const FVector& HitLocation, float Tolerance) const
+{
+	FBox HitBox;
+	if (!GetRewoundBox(Actor, Time, HitBox))
+	{
+		return EWSRewindHitResult::NotTracked;
+	}
+
+	HitBox = HitBox.ExpandBy(Tolerance);
+
+	// extend the shot slightly past the reported location, the hit point lies on the hitbox surface
+	const FVector ShotDir = (HitLocation - TraceStart).GetSafeNormal();
+	const FVector TraceEnd = HitLocation + ShotDir * Tolerance;
+
+	return FMath::LineBoxIntersection(HitBox, TraceStart, TraceEnd, TraceEnd - TraceStart) ? EWSRewindHitResult::Hit : EWSRewindHitResult::Miss;
+}
+
+double UWSLagCompensationSubsystem::GetShotRewindTime(const APawn* Shooter, double ClientShotTime) const
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+	double ShotTime = FMath::Min(ClientShotTime, Now);
+
+	// shooter saw other pawns as they were half a round trip before the shot
+	const APlayerState* PlayerState = Shooter ? Shooter->GetPlayerState() : nullptr;
+	if (PlayerState)
+	{
+		ShotTime -= PlayerState->GetPingInMilliseconds() * 0.0005;
+	}
+
+	return FMath::Max(ShotTime, Now - MaxRewindTime);
+}
+
+bool UWSLagCompensationSubsystem::IsRecording() const
+{
+	const ENetMode NetMode = GetWorld()->GetNetMode();
+	return NetMode == NM_DedicatedServer || NetMode == NM_ListenServer;
+}
+
+void UWSLagCompensationSubsystem::OnActorSpawned(AActor* Actor)
+{
+	if (Actor->IsA<APawn>() && !Actor->IsA<ASpectatorPawn>() && IsRecording())
+	{
+		RegisterActor(Actor);
+	}
+}
+
+void UWSLagCompensationSubsystem::ReleaseSlot(int32 Slot)
+{
+	ActorSlots.Remove(SlotKeys[Slot]);
+	SlotActors[Slot].Reset();
+	SlotKeys[Slot] = TObjectKey<AActor>();
+	FreeSlots.Add(Slot);
+}
@@ -0,0 +1,376 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSProjectileGuidanceSubsystem.h"
+#include "WeaponSystem.h"
+#include "WSProjectile.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/SpectatorPawn.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Guidance Target Index"), STAT_WSGuidanceTargetIndex, STATGROUP_WeaponSystem);
+DECLARE_CYCLE_STAT(TEXT("Guidance Steering"), STAT_WSGuidanceSteering, STATGROUP_WeaponSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Guided Projectiles"), STAT_WSGuidedProjectiles, STATGROUP_WeaponSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Guidance Targets"), STAT_WSGuidanceTargets, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Guidance Target Searches"), STAT_WSGuidanceTargetSearches, STATGROUP_WeaponSystem);
+
+void UWSProjectileGuidanceSubsystem::Deinitialize()
+{
+	Projectiles.Empty();
+	Targets.Empty();
+	TargetKeys.Empty();
+	TargetLocations.Empty();
+	TargetCells.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UWSProjectileGuidanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UWSProjectileGuidanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWSProjectileGuidanceSubsystem, STATGROUP_Tickables);
+}
+
+void UWSProjectileGuidanceSubsystem::RegisterProjectile(AWSProjectile* Projectile)
+{
+	if (Projectile == nullptr || Projectile->GuidanceIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	FWSGuidedProjectile& Entry = Projectiles.AddDefaulted_GetRef();
+	Entry.Projectile = Projectile;
+	Entry.NextAcquireTime = 0.0;
+
+	Projectile->GuidanceIndex = Projectiles.Num() - 1;
+}
+
+void UWSProjectileGuidanceSubsystem::UnregisterProjectile(AWSProjectile* Projectile)
+{
+	if (Projectile == nullptr || !Projectiles.IsValidIndex(Projectile->GuidanceIndex))
+	{
+		return;
+	}
+
+	// entry is removed on the next tick
+	Projectiles[Projectile->GuidanceIndex].Projectile.Reset();
+	Projectile->GuidanceIndex = INDEX_NONE;
+}
+
+void UWSProjectileGuidanceSubsystem::CompactProjectiles()
+{
+	for (int32 Index = Projectiles.Num() - 1; Index >= 0; Index--)
+	{
+		if (Projectiles[Index].Projectile.IsValid())
+		{
+			continue;
+		}
+
+		Projectiles.RemoveAtSwap(Index, 1, false);
+		if (Projectiles.IsValidIndex(Index))
+		{
+			Projectiles[Index].Projectile->GuidanceIndex = Index;
+		}
+	}
+}
+
+FIntVector UWSProjectileGuidanceSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void UWSProjectileGuidanceSubsystem::BuildTargetIndex()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WSGuidanceTargetIndex);
+
+	Targets.Reset();
+	TargetKeys.Reset();
+	TargetLocations.Reset();
+	TargetCells.Reset();
+
+	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+	{
+		APawn* Pawn = *It;
+		if (!IsValid(Pawn) || Pawn->IsA<ASpectatorPawn>() || Pawn->IsHidden())
+		{
+			continue;
+		}
+
+		const int32 TargetIndex = Targets.Add(Pawn);
+		TargetKeys.Add(Pawn);
+		TargetLocations.Add(Pawn->GetActorLocation());
+		TargetCells.FindOrAdd(GetCell(TargetLocations[TargetIndex])).Add(TargetIndex);
+	}
+
+	SET_DWORD_STAT(STAT_WSGuidanceTargets, Targets.Num());
+}
+
+bool UWSProjectileGuidanceSubsystem::IsTargetInCone(const FWSGuidanceQuery& Query, const FVector& TargetLocation) const
+{
+	const FVector ToTarget = TargetLocation - Query.Location;
+	const double DistSquared = ToTarget.SizeSquared();
+	if (DistSquared > FMath::Square(Query.HomingRadius) || DistSquared < UE_KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	return FVector::DotProduct(Query.Velocity.GetSafeNormal(), ToTarget / FMath::Sqrt(DistSquared)) >= Query.HomingCosAngle;
+}
+
+int32 UWSProjectileGuidanceSubsystem::SelectTarget(const FWSGuidanceQuery& Query) const
+{
+	const FVector Direction = Query.Velocity.GetSafeNormal();
+	const FIntVector MinCell = GetCell(Query.Location - FVector(Query.HomingRadius));
+	const FIntVector MaxCell = GetCell(Query.Location + FVector(Query.HomingRadius));
+
+	// closest to the projectile heading wins
+	int32 BestTarget = INDEX_NONE;
+	double BestDot = Query.HomingCosAngle;
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++)
+			{
+				const TArray<int32>* Cell = TargetCells.Find(FIntVector(X, Y, Z));
+				if (Cell == nullptr)
+				{
+					continue;
+				}
+
+				for (const int32 TargetIndex : *Cell)
+				{
+					if (TargetKeys[TargetIndex] == Query.Instigator)
+					{
+						continue;
+					}
+
+					const FVector ToTarget = TargetLocations[TargetIndex] - Query.Location;
+					const double DistSquared = ToTarget.SizeSquared();
+					if (DistSquared > FMath::Square(Query.HomingRadius) || DistSquared < UE_KINDA_SMALL_NUMBER)
+					{
+						continue;
+					}
+
+					const double Dot = FVector::DotProduct(Direction, ToTarget / FMath::Sqrt(DistSquared));
+					if (Dot >= BestDot)
+					{
+						BestTarget = TargetIndex;
+						BestDot = Dot;
+					}
+				}
+			}
+		}
+	}
+
+	return BestTarget;
+}
+
+FVector UWSProjectileGuidanceSubsystem::SteerVelocity(const FVector& Location, const FVector& Velocity, const FVector& Goal, float MaxAngle)
+{
+	double Speed;
+	FVector Direction;
+	Velocity.ToDirectionAndLength(Direction, Speed);
+
+	const FVector ToGoal = (Goal - Location).GetSafeNormal();
+	if (Speed < UE_KINDA_SMALL_NUMBER || ToGoal.IsZero())
+	{
+		return Velocity;
+	}
+
+	const double Angle = FMath::Acos(FMath::Clamp(FVector::DotProduct(Direction, ToGoal), -1.0, 1.0));
+	if (Angle <= MaxAngle)
+	{
+		return ToGoal * Speed;
+	}
+
+	// goal right behind, turn any way
+	FVector Axis = FVector::CrossProduct(Direction, ToGoal);
+	if (!Axis.Normalize())
+	{
+		Axis = FVector::CrossProduct(Direction, FMath::Abs(Direction.Z) < 0.99 ? FVector::UpVector : FVector::ForwardVector).GetSafeNormal();
+	}
+
+	return FQuat(Axis, MaxAngle).RotateVector(Direction) * Speed;
+}
+
+void UWSProjectileGuidanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	CompactProjectiles();
+
+	SET_DWORD_STAT(STAT_WSGuidedProjectiles, Projectiles.Num());
+
+	if (Projectiles.Num() == 0)
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// gather projectile state, aim of each weapon is read once
+	Queries.Reset();
+	TMap<const AWSWeapon_Projectile*, FVector, TInlineSetAllocator<16>> WeaponAimLocations;
+	bool bAnyHoming = false;
+
+	for (FWSGuidedProjectile& Entry : Projectiles)
+	{
+		const AWSProjectile* Projectile = Entry.Projectile.Get();
+		const FProjectileWeaponData& Config = Projectile->WeaponConfig;
+
+		FWSGuidanceQuery& Query = Queries.AddDefaulted_GetRef();
+		Query.Location = Projectile->GetActorLocation();
+		Query.Velocity = Projectile->MovementComp->Velocity;
+		Query.AimLocation = FVector::ZeroVector;
+		Query.Instigator = Projectile->GetInstigator();
+		Query.TurnRate = Config.GuidanceTurnRate;
+		Query.HomingRadius = Config.HomingRadius;
+		Query.HomingCosAngle = FMath::Cos(FMath::DegreesToRadians(Config.HomingConeAngle));
+		Query.TargetIndex = INDEX_NONE;
+		Query.bHoming = Config.Guidance == EProjectileGuidance::EPG_Homing;
+		Query.bHasAimLocation = false;
+		Query.bAcquireTarget = false;
+
+		// projectile stopped by impact
+		if (Projectile->MovementComp->HasStoppedSimulation())
+		{
+			Query.TurnRate = 0.0f;
+			continue;
+		}
+
+		if (Query.bHoming)
+		{
+			bAnyHoming = true;
+			Query.bAcquireTarget = Now >= Entry.NextAcquireTime;
+		}
+		else if (const AWSWeapon_Projectile* Weapon = Cast<AWSWeapon_Projectile>(Projectile->GetOwner()))
+		{
+			// weapon put away or dropped, projectile flies straight
+			if (Weapon->GetWeaponComponent())
+			{
+				FVector* AimLocation = WeaponAimLocations.Find(Weapon);
+				if (AimLocation == nullptr)
+				{
+					const FVector AimDir = Weapon->GetAdjustedAim();
+					AimLocation = &WeaponAimLocations.Add(Weapon, Weapon->GetDamageStartLocation(AimDir) + AimDir * Config.GuidanceRange);
+				}
+
+				Query.AimLocation = *AimLocation;
+				Query.bHasAimLocation = true;
+			}
+		}
+	}
+
+	if (bAnyHoming)
+	{
+		BuildTargetIndex();
+
+		// locked targets keep tracking while they stay alive
+		TMap<const AActor*, int32> TargetIndices;
+		TargetIndices.Reserve(TargetKeys.Num());
+		for (int32 TargetIndex = 0; TargetIndex < TargetKeys.Num(); TargetIndex++)
+		{
+			TargetIndices.Add(TargetKeys[TargetIndex], TargetIndex);
+		}
+
+		for (int32 Index = 0; Index < Projectiles.Num(); Index++)
+		{
+			const AActor* Target = Projectiles[Index].Target.Get();
+			const int32* TargetIndex = Target ? TargetIndices.Find(Target) : nullptr;
+			Queries[Index].TargetIndex = TargetIndex ? *TargetIndex : INDEX_NONE;
+
+			// only projectiles without target search
+			Queries[Index].bAcquireTarget &= Queries[Index].TargetIndex == INDEX_NONE;
+		}
+	}
+
+	const int32 NumProjectiles = Queries.Num();
+	NewVelocities.SetNumUninitialized(NumProjectiles, false);
+	NewTargets.SetNumUninitialized(NumProjectiles, false);
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_WSGuidanceSteering);
+
+		const int32 NumPerChunk = FMath::Max(ChunkSize, 1);
+		const int32 NumChunks = FMath::DivideAndRoundUp(NumProjectiles, NumPerChunk);
+
+		ParallelFor(NumChunks, [&](int32 ChunkIndex)
+		{
+			const int32 ChunkStart = ChunkIndex * NumPerChunk;
+			const int32 ChunkEnd = FMath::Min(ChunkStart + NumPerChunk, NumProjectiles);
+			for (int32 Index = ChunkStart; Index < ChunkEnd; Index++)
+			{
+				const FWSGuidanceQuery& Query = Queries[Index];
+				NewVelocities[Index] = Query.Velocity;
+				NewTargets[Index] = Query.TargetIndex;
+
+				if (Query.TurnRate <= 0.0f)
+				{
+					continue;
+				}
+
+				FVector Goal;
+				if (Query.bHoming)
+				{
+					// target lost when it leaves the seeker cone
+					if (NewTargets[Index] != INDEX_NONE && !IsTargetInCone(Query, TargetLocations[NewTargets[Index]]))
+					{
+						NewTargets[Index] = INDEX_NONE;
+					}
+
+					if (NewTargets[Index] == INDEX_NONE && Query.bAcquireTarget)
+					{
+						NewTargets[Index] = SelectTarget(Query);
+					}
+
+					if (NewTargets[Index] == INDEX_NONE)
+					{
+						continue;
+					}
+
+					Goal = TargetLocations[NewTargets[Index]];
+				}
+				else if (Query.bHasAimLocation)
+				{
+					Goal = Query.AimLocation;
+				}
+				else
+				{
+					continue;
+				}
+
+				NewVelocities[Index] = SteerVelocity(Query.Location, Query.Velocity, Goal, FMath::DegreesToRadians(Query.TurnRate) * DeltaTime);
+			}
+		}, !bParallelSteering || !FApp::ShouldUseThreadingForPerformance());
+	}
+
+	// apply on game thread
+	for (int32 Index = 0; Index < NumProjectiles; Index++)
+	{
+		FWSGuidedProjectile& Entry = Projectiles[Index];
+		const FWSGuidanceQuery& Query = Queries[Index];
+
+		if (Query.bHoming)
+		{
+			Entry.Target = NewTargets[Index] != INDEX_NONE ? Targets[NewTargets[Index]] : nullptr;
+
+			if (Query.bAcquireTarget)
+			{
+				INC_DWORD_STAT(STAT_WSGuidanceTargetSearches);
+				Entry.NextAcquireTime = Now + AcquireInterval;
+			}
+		}
+
+		if (Query.TurnRate > 0.0f)
+		{
+			Entry.Projectile->MovementComp->Velocity = NewVelocities[Index];
+		}
+	}
+}
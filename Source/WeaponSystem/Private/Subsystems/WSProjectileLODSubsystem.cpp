@@ -0,0 +1,234 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSProjectileLODSubsystem.h"
+#include "WeaponSystem.h"
+#include "WSProjectile.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile LOD"), STAT_WSProjectileLOD, STATGROUP_WeaponSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles At Far LOD"), STAT_WSFarProjectiles, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Movement Updates"), STAT_WSProjectileMovementUpdates, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Updates Over Budget"), STAT_WSProjectileUpdatesOverBudget, STATGROUP_WeaponSystem);
+
+void UWSProjectileLODSubsystem::Deinitialize()
+{
+	Projectiles.Empty();
+	DueProjectiles.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UWSProjectileLODSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UWSProjectileLODSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWSProjectileLODSubsystem, STATGROUP_Tickables);
+}
+
+void UWSProjectileLODSubsystem::RegisterProjectile(AWSProjectile* Projectile)
+{
+	if (!bEnableProjectileLOD || Projectile == nullptr || Projectile->LODIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	FWSProjectileLODState& State = Projectiles.AddDefaulted_GetRef();
+	State.Projectile = Projectile;
+	State.PendingTime = 0.0f;
+	State.LOD = EWSProjectileLOD::Near;
+	State.bCosmeticsEnabled = true;
+
+	Projectile->LODIndex = Projectiles.Num() - 1;
+
+	// movement is updated by subsystem, keep it from re-enabling its tick when updated component changes
+	Projectile->MovementComp->bAutoUpdateTickRegistration = false;
+	Projectile->MovementComp->SetComponentTickEnabled(false);
+}
+
+void UWSProjectileLODSubsystem::UnregisterProjectile(AWSProjectile* Projectile)
+{
+	if (Projectile == nullptr || !Projectiles.IsValidIndex(Projectile->LODIndex))
+	{
+		return;
+	}
+
+	// entry is removed on the next tick, projectile could be unregistered during update
+	Projectiles[Projectile->LODIndex].Projectile.Reset();
+	Projectile->LODIndex = INDEX_NONE;
+
+	Projectile->SetActorTickInterval(0.0f);
+	Projectile->MovementComp->bAutoUpdateTickRegistration = true;
+	Projectile->MovementComp->UpdateTickRegistration();
+}
+
+void UWSProjectileLODSubsystem::CompactProjectiles()
+{
+	for (int32 Index = Projectiles.Num() - 1; Index >= 0; Index--)
+	{
+		if (Projectiles[Index].Projectile.IsValid())
+		{
+			continue;
+		}
+
+		Projectiles.RemoveAtSwap(Index, 1, false);
+		if (Projectiles.IsValidIndex(Index))
+		{
+			Projectiles[Index].Projectile->LODIndex = Index;
+		}
+	}
+}
+
+EWSProjectileLOD UWSProjectileLODSubsystem::GetDistanceLOD(const FVector& Location, TConstArrayView<FVector> ViewLocations) const
+{
+	// no views yet, keep full rate
+	if (ViewLocations.Num() == 0)
+	{
+		return EWSProjectileLOD::Near;
+	}
+
+	double MinDistSquared = MAX_dbl;
+	for (const FVector& ViewLocation : ViewLocations)
+	{
+		MinDistSquared = FMath::Min(MinDistSquared, FVector::DistSquared(Location, ViewLocation));
+	}
+
+	if (MinDistSquared >= FMath::Square(FarDistance))
+	{
+		return EWSProjectileLOD::Far;
+	}
+
+	return MinDistSquared >= FMath::Square(MediumDistance) ? EWSProjectileLOD::Medium : EWSProjectileLOD::Near;
+}
+
+float UWSProjectileLODSubsystem::GetUpdateInterval(EWSProjectileLOD LOD) const
+{
+	switch (LOD)
+	{
+	case EWSProjectileLOD::Medium:
+		return MediumUpdateInterval;
+	case EWSProjectileLOD::Far:
+		return FarUpdateInterval;
+	default:
+		return 0.0f;
+	}
+}
+
+void UWSProjectileLODSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_WSProjectileLOD);
+
+	CompactProjectiles();
+
+	if (Projectiles.Num() == 0)
+	{
+		SET_DWORD_STAT(STAT_WSFarProjectiles, 0);
+		return;
+	}
+
+	// server keeps views of remote players too
+	TArray<FVector, TInlineAllocator<16>> ViewLocations;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+
+	// nothing is rendered on dedicated server
+	const bool bHasRendering = GetWorld()->GetNetMode() != NM_DedicatedServer;
+
+	uint32 NumFar = 0;
+	DueProjectiles.Reset();
+
+	for (int32 Index = 0; Index < Projectiles.Num(); Index++)
+	{
+		FWSProjectileLODState& State = Projectiles[Index];
+		AWSProjectile* Projectile = State.Projectile.Get();
+
+		// stopped projectiles wait for destruction or the pool
+		if (Projectile == nullptr || Projectile->MovementComp->HasStoppedSimulation())
+		{
+			State.PendingTime = 0.0f;
+			continue;
+		}
+
+		State.PendingTime += DeltaTime;
+
+		const EWSProjectileLOD DistanceLOD = GetDistanceLOD(Projectile->GetActorLocation(), ViewLocations);
+
+		// hidden projectile is never rendered, so only distance turns cosmetics off
+		const bool bCosmeticsEnabled = DistanceLOD != EWSProjectileLOD::Far;
+		if (bHasRendering && bCosmeticsEnabled != State.bCosmeticsEnabled)
+		{
+			Projectile->SetCosmeticsEnabled(bCosmeticsEnabled);
+			State.bCosmeticsEnabled = bCosmeticsEnabled;
+		}
+
+		// projectile out of sight drops one level
+		EWSProjectileLOD NewLOD = DistanceLOD;
+		if (bHasRendering && DistanceLOD != EWSProjectileLOD::Far && !Projectile->WasRecentlyRendered(UnobservedTime))
+		{
+			NewLOD = static_cast<EWSProjectileLOD>(static_cast<uint8>(DistanceLOD) + 1);
+		}
+
+		if (NewLOD != State.LOD)
+		{
+			Projectile->SetActorTickInterval(GetUpdateInterval(NewLOD));
+			State.LOD = NewLOD;
+		}
+
+		NumFar += State.LOD == EWSProjectileLOD::Far ? 1 : 0;
+
+		if (State.PendingTime >= GetUpdateInterval(State.LOD))
+		{
+			DueProjectiles.Add(Index);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_WSFarProjectiles, NumFar);
+
+	// the most overdue projectiles first, projectiles skipped by the budget rise to the front on the next tick
+	const float MinInterval = FMath::Max(DeltaTime, UE_KINDA_SMALL_NUMBER);
+	DueProjectiles.Sort([this, MinInterval](const int32 A, const int32 B)
+	{
+		const FWSProjectileLODState& StateA = Projectiles[A];
+		const FWSProjectileLODState& StateB = Projectiles[B];
+		return StateA.PendingTime / FMath::Max(GetUpdateInterval(StateA.LOD), MinInterval) > StateB.PendingTime / FMath::Max(GetUpdateInterval(StateB.LOD), MinInterval);
+	});
+
+	const double EndTime = FPlatformTime::Seconds() + TimeBudgetMs * 0.001;
+	for (int32 DueIndex = 0; DueIndex < DueProjectiles.Num(); DueIndex++)
+	{
+		if (FPlatformTime::Seconds() > EndTime)
+		{
+			INC_DWORD_STAT_BY(STAT_WSProjectileUpdatesOverBudget, DueProjectiles.Num() - DueIndex);
+			break;
+		}
+
+		// impact may destroy or release other projectiles
+		FWSProjectileLODState& State = Projectiles[DueProjectiles[DueIndex]];
+		AWSProjectile* Projectile = State.Projectile.Get();
+		if (Projectile == nullptr)
+		{
+			continue;
+		}
+
+		// movement sweeps the whole pending time in one step
+		const float PendingTime = State.PendingTime;
+		State.PendingTime = 0.0f;
+		Projectile->FastForward(PendingTime);
+
+		INC_DWORD_STAT(STAT_WSProjectileMovementUpdates);
+	}
+}
@@ -0,0 +1,138 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSProjectilePoolSubsystem.h"
+#include "WeaponSystem.h"
+#include "WSProjectile.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Hits"), STAT_WSProjectilePoolHits, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Pool Misses"), STAT_WSProjectilePoolMisses, STATGROUP_WeaponSystem);
+
+void UWSProjectilePoolSubsystem::Deinitialize()
+{
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UWSProjectilePoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+AWSProjectile* UWSProjectilePoolSubsystem::SpawnProjectile(TSubclassOf<AWSProjectile> ProjectileClass, const FTransform& SpawnTransform, AActor* Owner, APawn* Instigator, const FVector& ShootDir)
+{
+	if (ProjectileClass == nullptr)
+	{
+		return nullptr;
+	}
+
+	AWSProjectile* Projectile = nullptr;
+	if (IsPoolingEnabled())
+	{
+		FWSProjectilePool& Pool = Pools.FindOrAdd(ProjectileClass);
+		while (Pool.FreeProjectiles.Num() > 0)
+		{
+			// skip projectiles destroyed outside of the pool
+			AWSProjectile* FreeProjectile = Pool.FreeProjectiles.Pop(false);
+			if (IsValid(FreeProjectile))
+			{
+				Projectile = FreeProjectile;
+				break;
+			}
+			Pool.NumCreated--;
+		}
+
+		if (Projectile)
+		{
+			NumPoolHits++;
+			INC_DWORD_STAT(STAT_WSProjectilePoolHits);
+		}
+		else
+		{
+			NumPoolMisses++;
+			INC_DWORD_STAT(STAT_WSProjectilePoolMisses);
+
+			if (Pool.NumCreated < MaxPoolSize)
+			{
+				Projectile = CreatePooledProjectile(ProjectileClass, Pool);
+			}
+		}
+	}
+
+	if (Projectile == nullptr)
+	{
+		// pool is full, spawn self destroying projectile
+		AWSProjectile* SpawnedProjectile = Cast<AWSProjectile>(UGameplayStatics::BeginDeferredActorSpawnFromClass(this, ProjectileClass, SpawnTransform));
+		if (SpawnedProjectile)
+		{
+			SpawnedProjectile->SetInstigator(Instigator);
+			SpawnedProjectile->SetOwner(Owner);
+			SpawnedProjectile->InitVelocity(ShootDir);
+
+			UGameplayStatics::FinishSpawningActor(SpawnedProjectile, SpawnTransform);
+		}
+		return SpawnedProjectile;
+	}
+
+	Projectile->ActivateFromPool(SpawnTransform, Owner, Instigator, ShootDir);
+	return Projectile;
+}
+
+void UWSProjectilePoolSubsystem::PrewarmPool(TSubclassOf<AWSProjectile> ProjectileClass, int32 Count)
+{
+	if (ProjectileClass == nullptr || !IsPoolingEnabled())
+	{
+		return;
+	}
+
+	const int32 NumProjectiles = FMath::Min(Count == INDEX_NONE ? PrewarmCount : Count, MaxPoolSize);
+
+	FWSProjectilePool& Pool = Pools.FindOrAdd(ProjectileClass);
+	while (Pool.NumCreated < NumProjectiles)
+	{
+		AWSProjectile* Projectile = CreatePooledProjectile(ProjectileClass, Pool);
+		if (Projectile == nullptr)
+		{
+			break;
+		}
+
+		Pool.FreeProjectiles.Add(Projectile);
+	}
+}
+
+bool UWSProjectilePoolSubsystem::IsPoolingEnabled() const
+{
+	return GetWorld()->GetNetMode() != NM_Client;
+}
+
+AWSProjectile* UWSProjectilePoolSubsystem::CreatePooledProjectile(TSubclassOf<AWSProjectile> ProjectileClass, FWSProjectilePool& Pool)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.bDeferConstruction = true;
+
+	AWSProjectile* Projectile = GetWorld()->SpawnActor<AWSProjectile>(ProjectileClass, FTransform::Identity, SpawnParams);
+	if (Projectile)
+	{
+		// pooled projectile starts in the pool and is activated explicitly
+		Projectile->bPooled = true;
+		UGameplayStatics::FinishSpawningActor(Projectile, FTransform::Identity);
+		Projectile->DeactivateToPool();
+
+		Pool.NumCreated++;
+	}
+
+	return Projectile;
+}
+
+void UWSProjectilePoolSubsystem::ReleaseProjectile(AWSProjectile* Projectile)
+{
+	if (Projectile == nullptr || Projectile->IsInPool())
+	{
+		return;
+	}
+
+	Projectile->DeactivateToPool();
+	Pools.FindOrAdd(Projectile->GetClass()).FreeProjectiles.Add(Projectile);
+}
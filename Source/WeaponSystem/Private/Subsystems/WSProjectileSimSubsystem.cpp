@@ -0,0 +1,410 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSProjectileSimSubsystem.h"
+#include "WeaponSystem.h"
+#include "WSProjectile.h"
+#include "WSProjectileSimReplicator.h"
+#include "Components/SphereComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Async/ParallelFor.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Sim"), STAT_WSProjectileSim, STATGROUP_WeaponSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Simulated Projectiles"), STAT_WSSimulatedProjectiles, STATGROUP_WeaponSystem);
+
+void UWSProjectileSimSubsystem::Deinitialize()
+{
+	for (const TWeakObjectPtr<UParticleSystemComponent>& Visual : Visuals)
+	{
+		if (Visual.IsValid())
+		{
+			Visual->ReleaseToPool();
+		}
+	}
+
+	Configs.Empty();
+	ChunkResults.Empty();
+	Positions.Empty();
+	Velocities.Empty();
+	GravityScales.Empty();
+	RemainingLifes.Empty();
+	PendingTimes.Empty();
+	ConfigIndices.Empty();
+	Owners.Empty();
+	Instigators.Empty();
+	InstigatorControllers.Empty();
+	ProjectileIds.Empty();
+	Visuals.Empty();
+	PendingSpawnRecords.Empty();
+	PendingExplosions.Empty();
+	Replicator = nullptr;
+
+	Super::Deinitialize();
+}
+
+bool UWSProjectileSimSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UWSProjectileSimSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// channel is opened to clients before the first record is sent
+	const ENetMode NetMode = InWorld.GetNetMode();
+	if (NetMode == NM_DedicatedServer || NetMode == NM_ListenServer)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		Replicator = InWorld.SpawnActor<AWSProjectileSimReplicator>(SpawnParams);
+	}
+}
+
+TStatId UWSProjectileSimSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWSProjectileSimSubsystem, STATGROUP_Tickables);
+}
+
+bool UWSProjectileSimSubsystem::SpawnProjectile(AWSWeapon_Projectile* Weapon, const FProjectileSpawnRecord& SpawnRecord)
+{
+	if (Positions.Num() >= MaxProjectiles)
+	{
+		return false;
+	}
+
+	// server fills the fields clients need to simulate the projectile without its weapon
+	FProjectileSpawnRecord Record = SpawnRecord;
+	if (Weapon)
+	{
+		Record.WeaponClass = Weapon->GetClass();
+		Record.Instigator = Weapon->GetInstigator();
+		Record.ProjectileId = ++ProjectileCounter;
+	}
+
+	const int32 ConfigIndex = GetConfigIndex(Record.WeaponClass);
+	if (ConfigIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const FWSProjectileSimConfig& Config = Configs[ConfigIndex];
+	const AWSProjectile* DefaultProjectile = Config.WeaponConfig.ProjectileClass->GetDefaultObject<AWSProjectile>();
+
+	APawn* WeaponInstigator = Record.Instigator;
+	const float ProjectileLife = Config.WeaponConfig.ProjectileLife > 0.0f ? Config.WeaponConfig.ProjectileLife : MAX_flt;
+
+	// catch up with server projectile, it is moved on the next tick
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	const double ServerTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+	const float TimeSinceSpawn = FMath::Clamp(static_cast<float>(ServerTime - Record.ServerTime), 0.0f, ProjectileLife);
+
+	UParticleSystemComponent* Visual = nullptr;
+	if (Config.TrailFX && GetWorld()->GetNetMode() != NM_DedicatedServer)
+	{
+		Visual = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), Config.TrailFX, Record.Origin, Record.ShootDir.Rotation(), FVector(1.0f), true, EPSCPoolMethod::ManualRelease);
+	}
+
+	Positions.Add(Record.Origin);
+	Velocities.Add(Record.ShootDir * Config.InitialSpeed);
+	GravityScales.Add(DefaultProjectile->GetMovementComp()->ProjectileGravityScale);
+	RemainingLifes.Add(ProjectileLife);
+	PendingTimes.Add(TimeSinceSpawn);
+	ConfigIndices.Add(ConfigIndex);
+	Owners.Add(Weapon);
+	Instigators.Add(WeaponInstigator);
+	InstigatorControllers.Add(WeaponInstigator ? WeaponInstigator->GetController() : nullptr);
+	ProjectileIds.Add(Record.ProjectileId);
+	Visuals.Add(Visual);
+
+	if (Weapon && Replicator)
+	{
+		PendingSpawnRecords.Add(Record);
+	}
+
+	return true;
+}
+
+void UWSProjectileSimSubsystem::ExplodeProjectile(const FProjectileExplosionRecord& Record)
+{
+	const int32 ConfigIndex = GetConfigIndex(Record.WeaponClass);
+	if (ConfigIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// local projectile may be already removed by its own hit or never spawned if spawn record was dropped
+	const int32 Index = ProjectileIds.Find(Record.ProjectileId);
+	if (Index != INDEX_NONE)
+	{
+		RemoveProjectile(Index);
+	}
+
+	FHitResult Impact;
+	Record.Explosion.ToHitResult(Impact);
+
+	const FWSProjectileSimConfig Config = Configs[ConfigIndex];
+	AWSProjectile::SpawnExplosion(GetWorld(), Impact, Config.WeaponConfig, Config.ExplosionTemplate, nullptr, nullptr, Record.Explosion.SurfaceType);
+}
+
+int32 UWSProjectileSimSubsystem::GetConfigIndex(TSubclassOf<AWSWeapon_Projectile> WeaponClass)
+{
+	if (WeaponClass == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 ExistingIndex = Configs.IndexOfByPredicate([WeaponClass](const FWSProjectileSimConfig& Config)
+	{
+		return Config.WeaponClass == WeaponClass;
+	});
+
+	if (ExistingIndex != INDEX_NONE)
+	{
+		return ExistingIndex;
+	}
+
+	// weapon config is edited on defaults only, class defaults match every weapon of the class
+	FWSProjectileSimConfig NewConfig;
+	NewConfig.WeaponClass = WeaponClass;
+	WeaponClass->GetDefaultObject<AWSWeapon_Projectile>()->ApplyWeaponConfig(NewConfig.WeaponConfig);
+
+	if (NewConfig.WeaponConfig.ProjectileClass == nullptr)
+	{
+		UE_LOG(LogWeaponSystem, Warning, TEXT("UWSProjectileSimSubsystem: %s has no projectile class"), *GetNameSafe(WeaponClass));
+		return INDEX_NONE;
+	}
+
+	// movement and collision settings are taken from projectile defaults so simulated projectiles match actors
+	const AWSProjectile* DefaultProjectile = NewConfig.WeaponConfig.ProjectileClass->GetDefaultObject<AWSProjectile>();
+	const UProjectileMovementComponent* MovementComp = DefaultProjectile->GetMovementComp();
+	const USphereComponent* CollisionComp = DefaultProjectile->GetCollisionComp();
+
+	NewConfig.ExplosionTemplate = DefaultProjectile->ExplosionTemplate;
+	NewConfig.TrailFX = DefaultProjectile->GetParticleComp()->Template;
+	NewConfig.CollisionResponses = CollisionComp->GetCollisionResponseToChannels();
+	NewConfig.CollisionRadius = CollisionComp->GetUnscaledSphereRadius();
+	NewConfig.InitialSpeed = MovementComp->InitialSpeed;
+	NewConfig.MaxSpeed = MovementComp->MaxSpeed;
+
+	return Configs.Add(NewConfig);
+}
+
+void UWSProjectileSimSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_WSProjectileSim);
+	SET_DWORD_STAT(STAT_WSSimulatedProjectiles, Positions.Num());
+
+	SimulateProjectiles(DeltaTime);
+	ReplicateRecords();
+}
+
+void UWSProjectileSimSubsystem::SimulateProjectiles(float DeltaTime)
+{
+	if (Positions.Num() == 0)
+	{
+		return;
+	}
+
+	for (float& PendingTime : PendingTimes)
+	{
+		PendingTime += DeltaTime;
+	}
+
+	const double EndTime = FPlatformTime::Seconds() + TimeBudgetMs * 0.001;
+	const float GravityZ = GetWorld()->GetGravityZ();
+
+	// chunks start from the first projectile skipped on the last tick
+	const int32 NumProjectiles = Positions.Num();
+	const int32 NumPerChunk = FMath::Max(ChunkSize, 1);
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumProjectiles, NumPerChunk);
+	const int32 FirstIndex = NextIndex < NumProjectiles ? NextIndex : 0;
+
+	ChunkResults.SetNum(NumChunks, false);
+	TArray<bool> ChunkSkipped;
+	ChunkSkipped.SetNumZeroed(NumChunks);
+
+	ParallelFor(NumChunks, [&](int32 ChunkIndex)
+	{
+		TArray<FWSProjectileSimResult>& Results = ChunkResults[ChunkIndex];
+		Results.Reset();
+
+		// out of budget, chunk keeps its pending time
+		if (FPlatformTime::Seconds() > EndTime)
+		{
+			ChunkSkipped[ChunkIndex] = true;
+			return;
+		}
+
+		const int32 ChunkStart = ChunkIndex * NumPerChunk;
+		const int32 ChunkEnd = FMath::Min(ChunkStart + NumPerChunk, NumProjectiles);
+		for (int32 Offset = ChunkStart; Offset < ChunkEnd; Offset++)
+		{
+			const int32 Index = (FirstIndex + Offset) % NumProjectiles;
+
+			FHitResult Impact;
+			if (SimulateProjectile(Index, GravityZ, Impact))
+			{
+				Results.Add({Index, Impact});
+			}
+		}
+	}, !bParallelSimulation || !FApp::ShouldUseThreadingForPerformance());
+
+	const int32 FirstSkippedChunk = ChunkSkipped.Find(true);
+	NextIndex = FirstSkippedChunk != INDEX_NONE ? (FirstIndex + FirstSkippedChunk * NumPerChunk) % NumProjectiles : 0;
+
+	ApplyResults();
+	UpdateVisuals();
+}
+
+void UWSProjectileSimSubsystem::ApplyResults()
+{
+	// chunks cover projectiles in a fixed order, sort to get the same order regardless of the start index
+	TArray<FWSProjectileSimResult> Results;
+	for (TArray<FWSProjectileSimResult>& Chunk : ChunkResults)
+	{
+		Results.Append(MoveTemp(Chunk));
+		Chunk.Reset();
+	}
+
+	if (Results.Num() == 0)
+	{
+		return;
+	}
+
+	Results.Sort([](const FWSProjectileSimResult& A, const FWSProjectileSimResult& B)
+	{
+		return A.Index < B.Index;
+	});
+
+	// clients wait for replicated explosion
+	const bool bAuthority = GetWorld()->GetNetMode() != NM_Client;
+	for (const FWSProjectileSimResult& Result : Results)
+	{
+		if (Result.Impact.bBlockingHit && bAuthority)
+		{
+			// damage may fire new projectiles and grow configs, copy explosion settings first
+			const FWSProjectileSimConfig Config = Configs[ConfigIndices[Result.Index]];
+			AWSWeapon_Projectile* Owner = Owners[Result.Index].Get();
+			const FProjectileExplosionInfo Explosion(Result.Impact);
+			AWSProjectile::SpawnExplosion(GetWorld(), Result.Impact, Config.WeaponConfig, Config.ExplosionTemplate, Owner, InstigatorControllers[Result.Index].Get(), Explosion.SurfaceType);
+
+			if (Replicator)
+			{
+				FProjectileExplosionRecord& Record = PendingExplosions.AddDefaulted_GetRef();
+				Record.ProjectileId = ProjectileIds[Result.Index];
+				Record.WeaponClass = Config.WeaponClass;
+				Record.Explosion = Explosion;
+			}
+		}
+	}
+
+	// remove from the back so swapped projectiles are never ones still to remove
+	for (int32 ResultIndex = Results.Num() - 1; ResultIndex >= 0; ResultIndex--)
+	{
+		RemoveProjectile(Results[ResultIndex].Index);
+	}
+}
+
+bool UWSProjectileSimSubsystem::SimulateProjectile(int32 Index, float GravityZ, FHitResult& OutImpact)
+{
+	const float DeltaTime = PendingTimes[Index];
+	if (DeltaTime <= 0.0f)
+	{
+		return false;
+	}
+
+	PendingTimes[Index] = 0.0f;
+	RemainingLifes[Index] -= DeltaTime;
+	if (RemainingLifes[Index] <= 0.0f)
+	{
+		return true;
+	}
+
+	const FWSProjectileSimConfig& Config = Configs[ConfigIndices[Index]];
+
+	FVector& Velocity = Velocities[Index];
+	Velocity.Z += GravityZ * GravityScales[Index] * DeltaTime;
+	if (Config.MaxSpeed > 0.0f)
+	{
+		Velocity = Velocity.GetClampedToMaxSize(Config.MaxSpeed);
+	}
+
+	const FVector Start = Positions[Index];
+	const FVector End = Start + Velocity * DeltaTime;
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ProjSim), true, Instigators[Index].Get());
+	const FCollisionResponseParams ResponseParams(Config.CollisionResponses);
+
+	// scene queries are read only and safe to run from workers
+	const bool bHit = Config.CollisionRadius > 0.0f
+		? GetWorld()->SweepSingleByChannel(OutImpact, Start, End, FQuat::Identity, COLLISION_PROJECTILE, FCollisionShape::MakeSphere(Config.CollisionRadius), QueryParams, ResponseParams)
+		: GetWorld()->LineTraceSingleByChannel(OutImpact, Start, End, COLLISION_PROJECTILE, QueryParams, ResponseParams);
+
+	Positions[Index] = bHit ? OutImpact.Location : End;
+	return bHit;
+}
+
+void UWSProjectileSimSubsystem::ReplicateRecords()
+{
+	if (Replicator == nullptr)
+	{
+		PendingSpawnRecords.Reset();
+		PendingExplosions.Reset();
+		return;
+	}
+
+	// several smaller bunches instead of one that could exceed the max bunch size
+	const int32 BatchSize = FMath::Max(MaxRecordsPerBatch, 1);
+
+	for (int32 First = 0; First < PendingSpawnRecords.Num(); First += BatchSize)
+	{
+		const int32 Count = FMath::Min(BatchSize, PendingSpawnRecords.Num() - First);
+		Replicator->MulticastSpawnProjectiles(TArray<FProjectileSpawnRecord>(PendingSpawnRecords.GetData() + First, Count));
+	}
+
+	for (int32 First = 0; First < PendingExplosions.Num(); First += BatchSize)
+	{
+		const int32 Count = FMath::Min(BatchSize, PendingExplosions.Num() - First);
+		Replicator->MulticastExplodeProjectiles(TArray<FProjectileExplosionRecord>(PendingExplosions.GetData() + First, Count));
+	}
+
+	PendingSpawnRecords.Reset();
+	PendingExplosions.Reset();
+}
+
+void UWSProjectileSimSubsystem::UpdateVisuals()
+{
+	for (int32 Index = 0; Index < Visuals.Num(); Index++)
+	{
+		UParticleSystemComponent* Visual = Visuals[Index].Get();
+		if (Visual)
+		{
+			Visual->SetWorldLocationAndRotation(Positions[Index], Velocities[Index].Rotation());
+		}
+	}
+}
+
+void UWSProjectileSimSubsystem::RemoveProjectile(int32 Index)
+{
+	if (UParticleSystemComponent* Visual = Visuals[Index].Get())
+	{
+		Visual->ReleaseToPool();
+	}
+
+	Positions.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	GravityScales.RemoveAtSwap(Index, 1, false);
+	RemainingLifes.RemoveAtSwap(Index, 1, false);
+	PendingTimes.RemoveAtSwap(Index, 1, false);
+	ConfigIndices.RemoveAtSwap(Index, 1, false);
+	Owners.RemoveAtSwap(Index, 1, false);
+	Instigators.RemoveAtSwap(Index, 1, false);
+	InstigatorControllers.RemoveAtSwap(Index, 1, false);
+	ProjectileIds.RemoveAtSwap(Index, 1, false);
+	Visuals.RemoveAtSwap(Index, 1, false);
+}
@@ -0,0 +1,244 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSRadialDamageSubsystem.h"
+#include "WeaponSystem.h"
+#include "Engine/OverlapResult.h"
+#include "GameFramework/DamageType.h"
+
+DECLARE_CYCLE_STAT(TEXT("Radial Damage Resolve"), STAT_WSRadialDamage, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Radial Damage Explosions"), STAT_WSRadialDamageExplosions, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Radial Damage Traces"), STAT_WSRadialDamageTraces, STATGROUP_WeaponSystem);
+
+/** cached visibility of component from explosion origin */
+struct FWSRadialDamageTrace
+{
+	bool bVisible;
+	FHitResult Hit;
+};
+
+static FIntVector GetRadialDamageCell(const FVector& Location, float Size)
+{
+	return FIntVector(FMath::FloorToInt(Location.X / Size), FMath::FloorToInt(Location.Y / Size), FMath::FloorToInt(Location.Z / Size));
+}
+
+/** visibility test of UGameplayStatics::ApplyRadialDamage, trace from origin to component bounds center */
+static bool ComponentIsDamageableFrom(UPrimitiveComponent* VictimComp, const FVector& Origin, const AActor* IgnoredActor, FHitResult& OutHitResult)
+{
+	const FVector TraceEnd = VictimComp->Bounds.Origin;
+	FVector TraceStart = Origin;
+	if (Origin == TraceEnd)
+	{
+		// tiny nudge so line trace doesn't early out with no hits
+		TraceStart.Z += 0.01f;
+	}
+
+	FHitResult Hit;
+	if (VictimComp->GetWorld()->LineTraceSingleByChannel(Hit, TraceStart, TraceEnd, ECC_Visibility, FCollisionQueryParams(SCENE_QUERY_STAT(ComponentIsVisibleFrom), true, IgnoredActor)))
+	{
+		if (Hit.Component == VictimComp)
+		{
+			OutHitResult = Hit;
+			return true;
+		}
+		return false;
+	}
+
+	// nothing blocks the damage
+	const FVector FakeHitLocation = VictimComp->GetComponentLocation();
+	const FVector FakeHitNormal = (Origin - FakeHitLocation).GetSafeNormal();
+	OutHitResult = FHitResult(VictimComp->GetOwner(), VictimComp, FakeHitLocation, FakeHitNormal);
+	return true;
+}
+
+void UWSRadialDamageSubsystem::Deinitialize()
+{
+	PendingRequests.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UWSRadialDamageSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UWSRadialDamageSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWSRadialDamageSubsystem, STATGROUP_Tickables);
+}
+
+void UWSRadialDamageSubsystem::QueueRadialDamage(float BaseDamage, const FVector& Origin, float Radius, TSubclassOf<UDamageType> DamageType, AActor* DamageCauser, AController* InstigatorController)
+{
+	FWSRadialDamageRequest& Request = PendingRequests.AddDefaulted_GetRef();
+	Request.Origin = Origin;
+	Request.BaseDamage = BaseDamage;
+	Request.Radius = Radius;
+	Request.DamageType = DamageType;
+	Request.DamageCauser = DamageCauser;
+	Request.InstigatorController = InstigatorController;
+}
+
+void UWSRadialDamageSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (PendingRequests.Num() > 0)
+	{
+		ResolvePendingDamage();
+	}
+}
+
+void UWSRadialDamageSubsystem::ResolvePendingDamage()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WSRadialDamage);
+
+	// damage may trigger more explosions, they are resolved on the next frame
+	TArray<FWSRadialDamageRequest> Requests = MoveTemp(PendingRequests);
+	PendingRequests.Reset();
+
+	INC_DWORD_STAT_BY(STAT_WSRadialDamageExplosions, Requests.Num());
+
+	// broadphase
+	TMap<FIntVector, TArray<int32>> Cells;
+	for (int32 RequestIndex = 0; RequestIndex < Requests.Num(); RequestIndex++)
+	{
+		Cells.FindOrAdd(GetRadialDamageCell(Requests[RequestIndex].Origin, CellSize)).Add(RequestIndex);
+	}
+
+	TMap<TTuple<FIntVector, const UPrimitiveComponent*, const AActor*>, FWSRadialDamageTrace> Traces;
+	TMap<AActor*, TArray<FWSRadialDamageTarget>> Targets;
+	TMap<AActor*, TArray<FHitResult>> RequestHits;
+	TArray<FOverlapResult> Overlaps;
+
+	for (const TPair<FIntVector, TArray<int32>>& Cell : Cells)
+	{
+		// one overlap with sphere enclosing all explosions of the cell
+		FBox CellBounds(ForceInit);
+		for (const int32 RequestIndex : Cell.Value)
+		{
+			CellBounds += FBox::BuildAABB(Requests[RequestIndex].Origin, FVector(Requests[RequestIndex].Radius));
+		}
+
+		const FVector QueryCenter = CellBounds.GetCenter();
+		float QueryRadius = 0.0f;
+		for (const int32 RequestIndex : Cell.Value)
+		{
+			QueryRadius = FMath::Max(QueryRadius, FVector::Dist(QueryCenter, Requests[RequestIndex].Origin) + Requests[RequestIndex].Radius);
+		}
+
+		Overlaps.Reset();
+		GetWorld()->OverlapMultiByObjectType(Overlaps, QueryCenter, FQuat::Identity, FCollisionObjectQueryParams(FCollisionObjectQueryParams::InitType::AllDynamicObjects),
+			FCollisionShape::MakeSphere(QueryRadius), FCollisionQueryParams(SCENE_QUERY_STAT(ApplyRadialDamage), false));
+
+		for (const int32 RequestIndex : Cell.Value)
+		{
+			const FWSRadialDamageRequest& Request = Requests[RequestIndex];
+			const FIntVector TraceCell = GetRadialDamageCell(Request.Origin, TraceShareDistance);
+			const AActor* DamageCauser = Request.DamageCauser.Get();
+
+			// visible components of every actor inside explosion radius, overlap is shared so the causer is skipped here
+			// instead of being ignored by the query like ApplyRadialDamage does
+			RequestHits.Reset();
+			for (const FOverlapResult& Overlap : Overlaps)
+			{
+				AActor* Actor = Overlap.GetActor();
+				UPrimitiveComponent* Component = Overlap.GetComponent();
+				if (Actor == nullptr || Component == nullptr || Actor == DamageCauser)
+				{
+					continue;
+				}
+
+				FVector ClosestPoint;
+				float Distance = Component->GetDistanceToCollision(Request.Origin, ClosestPoint);
+				if (Distance < 0.0f)
+				{
+					Distance = FMath::Sqrt(Component->Bounds.GetBox().ComputeSquaredDistanceToPoint(Request.Origin));
+				}
+
+				if (Distance > Request.Radius)
+				{
+					continue;
+				}
+
+				// traces ignore the causer, so they are shared only between explosions of the same causer
+				const TTuple<FIntVector, const UPrimitiveComponent*, const AActor*> TraceKey(TraceCell, Component, DamageCauser);
+				FWSRadialDamageTrace* Trace = Traces.Find(TraceKey);
+				if (Trace == nullptr)
+				{
+					Trace = &Traces.Add(TraceKey);
+					Trace->bVisible = ComponentIsDamageableFrom(Component, Request.Origin, DamageCauser, Trace->Hit);
+					INC_DWORD_STAT(STAT_WSRadialDamageTraces);
+				}
+
+				if (Trace->bVisible)
+				{
+					RequestHits.FindOrAdd(Actor).Add(Trace->Hit);
+				}
+			}
+
+			// same falloff as UGameplayStatics::ApplyRadialDamage
+			const FRadialDamageParams DamageParams(Request.BaseDamage, 0.0f, 0.0f, Request.Radius, 1.0f);
+			for (TPair<AActor*, TArray<FHitResult>>& ActorHits : RequestHits)
+			{
+				float ClosestHitDistance = MAX_flt;
+				for (const FHitResult& Hit : ActorHits.Value)
+				{
+					ClosestHitDistance = FMath::Min(ClosestHitDistance, FVector::Dist(Hit.ImpactPoint, Request.Origin));
+				}
+
+				const float Damage = Request.BaseDamage * DamageParams.GetDamageScale(ClosestHitDistance);
+				if (Damage <= 0.0f)
+				{
+					continue;
+				}
+
+				TArray<FWSRadialDamageTarget>& ActorTargets = Targets.FindOrAdd(ActorHits.Key);
+				FWSRadialDamageTarget* Target = ActorTargets.FindByPredicate([&Request](const FWSRadialDamageTarget& Other)
+				{
+					return Other.DamageType == Request.DamageType && Other.DamageCauser == Request.DamageCauser && Other.InstigatorController == Request.InstigatorController;
+				});
+
+				if (Target == nullptr)
+				{
+					Target = &ActorTargets.AddDefaulted_GetRef();
+					Target->DamageType = Request.DamageType;
+					Target->DamageCauser = Request.DamageCauser;
+					Target->InstigatorController = Request.InstigatorController;
+					Target->TotalDamage = 0.0f;
+					Target->MaxDamage = 0.0f;
+					Target->MaxDamageRequest = RequestIndex;
+				}
+
+				Target->TotalDamage += Damage;
+				if (Damage > Target->MaxDamage)
+				{
+					Target->MaxDamage = Damage;
+					Target->MaxDamageRequest = RequestIndex;
+					Target->MaxDamageHits = MoveTemp(ActorHits.Value);
+				}
+			}
+		}
+	}
+
+	// single damage event per actor, falloff is already applied to the total so the event scales it by one
+	for (TPair<AActor*, TArray<FWSRadialDamageTarget>>& ActorTargets : Targets)
+	{
+		for (FWSRadialDamageTarget& Target : ActorTargets.Value)
+		{
+			if (!IsValid(ActorTargets.Key))
+			{
+				break;
+			}
+
+			const FWSRadialDamageRequest& Request = Requests[Target.MaxDamageRequest];
+
+			FRadialDamageEvent DamageEvent;
+			DamageEvent.DamageTypeClass = Target.DamageType ? Target.DamageType : TSubclassOf<UDamageType>(UDamageType::StaticClass());
+			DamageEvent.Origin = Request.Origin;
+			DamageEvent.Params = FRadialDamageParams(Target.TotalDamage, 0.0f, Request.Radius, Request.Radius, 0.0f);
+			DamageEvent.ComponentHits = MoveTemp(Target.MaxDamageHits);
+
+			ActorTargets.Key->TakeDamage(Target.TotalDamage, DamageEvent, Target.InstigatorController.Get(), Target.DamageCauser.Get());
+		}
+	}
+}
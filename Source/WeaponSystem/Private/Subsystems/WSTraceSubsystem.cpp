@@ -0,0 +1,117 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSTraceSubsystem.h"
+#include "Engine/World.h"
+
+namespace WSTrace
+{
+	/** trace user data layout: batch index in high bits, trace index inside the batch in low 8 bits */
+	constexpr uint32 TraceIndexBits = 8;
+	constexpr uint32 TraceIndexMask = (1u << TraceIndexBits) - 1;
+
+	FORCEINLINE uint32 PackUserData(int32 BatchIndex, int32 TraceIndex)
+	{
+		return (static_cast<uint32>(BatchIndex) << TraceIndexBits) | static_cast<uint32>(TraceIndex);
+	}
+}
+
+void UWSTraceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	TraceDelegate.BindUObject(this, &UWSTraceSubsystem::OnTraceCompleted);
+}
+
+void UWSTraceSubsystem::Deinitialize()
+{
+	QueuedBatches.Empty();
+	Batches.Empty();
+	TraceDelegate.Unbind();
+
+	Super::Deinitialize();
+}
+
+bool UWSTraceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UWSTraceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (QueuedBatches.Num() == 0)
+	{
+		return;
+	}
+
+	UWorld* World = GetWorld();
+
+	// dispatch the whole frame batch at once, so the async buffer is filled with consecutive requests
+	for (const int32 BatchIndex : QueuedBatches)
+	{
+		FTraceBatch& Batch = Batches[BatchIndex];
+		for (int32 TraceIndex = 0; TraceIndex < Batch.Ends.Num(); TraceIndex++)
+		{
+			World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Batch.Start, Batch.Ends[TraceIndex], Batch.TraceChannel, Batch.Params,
+				FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, WSTrace::PackUserData(BatchIndex, TraceIndex));
+		}
+	}
+
+	QueuedBatches.Reset();
+}
+
+TStatId UWSTraceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWSTraceSubsystem, STATGROUP_Tickables);
+}
+
+void UWSTraceSubsystem::QueueLineTraceBatch(const FVector& Start, TConstArrayView<FVector> Ends, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, FWSTraceBatchResultDelegate&& OnComplete)
+{
+	if (!ensure(Ends.Num() > 0 && Ends.Num() <= MaxTracesPerBatch))
+	{
+		return;
+	}
+
+	const int32 BatchIndex = Batches.Emplace();
+	FTraceBatch& Batch = Batches[BatchIndex];
+	Batch.Start = Start;
+	Batch.Ends.Append(Ends.GetData(), Ends.Num());
+	Batch.TraceChannel = TraceChannel;
+	Batch.Params = Params;
+	Batch.Hits.SetNum(Ends.Num());
+	Batch.NumPendingHits = Ends.Num();
+	Batch.OnComplete = MoveTemp(OnComplete);
+
+	QueuedBatches.Add(BatchIndex);
+}
+
+int32 UWSTraceSubsystem::GetNumPendingBatches() const
+{
+	return Batches.Num();
+}
+
+void UWSTraceSubsystem::OnTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Data)
+{
+	const int32 BatchIndex = static_cast<int32>(Data.UserData >> WSTrace::TraceIndexBits);
+	const int32 TraceIndex = static_cast<int32>(Data.UserData & WSTrace::TraceIndexMask);
+	if (!Batches.IsValidIndex(BatchIndex))
+	{
+		return;
+	}
+
+	FTraceBatch& Batch = Batches[BatchIndex];
+	Batch.Hits[TraceIndex] = Data.OutHits.Num() > 0 ? Data.OutHits[0] : FHitResult(Data.Start, Data.End);
+
+	if (--Batch.NumPendingHits > 0)
+	{
+		return;
+	}
+
+	// release the slot before executing, callback is allowed to queue new traces
+	const FWSTraceBatchResultDelegate OnComplete = MoveTemp(Batch.OnComplete);
+	const TArray<FHitResult, TInlineAllocator<1>> Hits = MoveTemp(Batch.Hits);
+	Batches.RemoveAt(BatchIndex);
+
+	OnComplete.ExecuteIfBound(Hits);
+}
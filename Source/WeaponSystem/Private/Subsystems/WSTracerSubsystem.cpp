@@ -0,0 +1,112 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSTracerSubsystem.h"
+#include "WeaponSystem.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spawned Tracers"), STAT_WSSpawnedTracers, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Culled Tracers"), STAT_WSCulledTracers, STATGROUP_WeaponSystem);
+
+bool UWSTracerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+UParticleSystemComponent* UWSTracerSubsystem::SpawnTracer(UParticleSystem* TrailFX, FName TargetParam, const FVector& Origin, const FVector& EndPoint, bool bImportant)
+{
+	if (TrailFX == nullptr || GetWorld()->GetNetMode() == NM_DedicatedServer)
+	{
+		return nullptr;
+	}
+
+	if (!bImportant && !ShouldSpawnTracer(Origin, EndPoint))
+	{
+		INC_DWORD_STAT(STAT_WSCulledTracers);
+		return nullptr;
+	}
+
+	INC_DWORD_STAT(STAT_WSSpawnedTracers);
+
+	UParticleSystemComponent* TrailPSC = UGameplayStatics::SpawnEmitterAtLocation(this, TrailFX, Origin, FRotator::ZeroRotator, FVector(1.0f), true, EPSCPoolMethod::AutoRelease);
+	if (TrailPSC)
+	{
+		TrailPSC->SetVectorParameter(TargetParam, EndPoint);
+	}
+
+	return TrailPSC;
+}
+
+bool UWSTracerSubsystem::ShouldSpawnTracer(const FVector& Origin, const FVector& EndPoint)
+{
+	UpdateFrame();
+
+	if (NumFrameTracers >= MaxTracersPerFrame)
+	{
+		return false;
+	}
+
+	if (bHasView)
+	{
+		const float ViewDistance = FMath::PointDistToSegment(ViewLocation, Origin, EndPoint);
+		if (ViewDistance > CullDistance)
+		{
+			return false;
+		}
+
+		// visible if any of the trail points is inside the view cone
+		if (bCullOutsideView && ViewDistance > UE_KINDA_SMALL_NUMBER)
+		{
+			const FVector MidPoint = (Origin + EndPoint) * 0.5;
+			const bool bInView =
+				FVector::DotProduct((Origin - ViewLocation).GetSafeNormal(), ViewDir) >= ViewCosHalfAngle ||
+				FVector::DotProduct((MidPoint - ViewLocation).GetSafeNormal(), ViewDir) >= ViewCosHalfAngle ||
+				FVector::DotProduct((EndPoint - ViewLocation).GetSafeNormal(), ViewDir) >= ViewCosHalfAngle;
+
+			if (!bInView)
+			{
+				return false;
+			}
+		}
+
+		// spawn every Nth distant tracer
+		if (ViewDistance > ThinningDistance && CullDistance > ThinningDistance)
+		{
+			const float ThinningAlpha = (ViewDistance - ThinningDistance) / (CullDistance - ThinningDistance);
+			const uint32 ThinningStep = 1 + FMath::FloorToInt(ThinningAlpha * (FMath::Max(1, MaxThinningStep) - 1));
+			if (ThinningCounter++ % ThinningStep != 0)
+			{
+				return false;
+			}
+		}
+	}
+
+	NumFrameTracers++;
+	return true;
+}
+
+void UWSTracerSubsystem::UpdateFrame()
+{
+	if (CachedFrame == GFrameCounter)
+	{
+		return;
+	}
+
+	CachedFrame = GFrameCounter;
+	NumFrameTracers = 0;
+
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	bHasView = PlayerController && PlayerController->PlayerCameraManager;
+	if (bHasView)
+	{
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		ViewDir = ViewRotation.Vector();
+
+		// horizontal FOV, wide enough to cover the vertical one as well
+		const float HalfAngle = FMath::DegreesToRadians(FMath::Min(PlayerController->PlayerCameraManager->GetFOVAngle() * 0.5f + 10.0f, 89.0f));
+		ViewCosHalfAngle = FMath::Cos(HalfAngle);
+	}
+}
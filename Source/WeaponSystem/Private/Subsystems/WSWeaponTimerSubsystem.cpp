@@ -0,0 +1,297 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSWeaponTimerSubsystem.h"
+#include "WeaponSystem.h"
+#include "WSWeapon.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Weapon Timers"), STAT_WSWeaponTimers, STATGROUP_WeaponSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Scheduled Weapon Timers"), STAT_WSScheduledWeaponTimers, STATGROUP_WeaponSystem);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fired Weapon Timers"), STAT_WSFiredWeaponTimers, STATGROUP_WeaponSystem);
+
+void UWSWeaponTimerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	ListHeads.Init(INDEX_NONE, NumLists);
+	CurrentTick = GetTick(GetWorld()->GetTimeSeconds());
+}
+
+void UWSWeaponTimerSubsystem::Deinitialize()
+{
+	Timers.Empty();
+	ListHeads.Empty();
+	DueTimers.Empty();
+	FreeHead = INDEX_NONE;
+	NumTimers = 0;
+
+	Super::Deinitialize();
+}
+
+bool UWSWeaponTimerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UWSWeaponTimerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWSWeaponTimerSubsystem, STATGROUP_Tickables);
+}
+
+int64 UWSWeaponTimerSubsystem::GetTick(double Time) const
+{
+	return FMath::FloorToInt64(Time / FMath::Max(SlotDuration, UE_KINDA_SMALL_NUMBER));
+}
+
+void UWSWeaponTimerSubsystem::SetTimer(FWSWeaponTimerHandle& Handle, AWSWeapon* Weapon, FWSWeaponTimerFunc Func, float Rate)
+{
+	ClearTimer(Handle);
+
+	if (Weapon == nullptr || Func == nullptr || Rate <= 0.0f)
+	{
+		return;
+	}
+
+	const int32 Index = AllocateTimer();
+	FWSWeaponTimer& Timer = Timers[Index];
+	Timer.Weapon = Weapon;
+	Timer.Func = Func;
+	Timer.ExpireTime = GetWorld()->GetTimeSeconds() + Rate;
+	Timer.Tick = FMath::Max(GetTick(Timer.ExpireTime), CurrentTick);
+
+	Schedule(Index);
+
+	Handle.Index = Index;
+	Handle.Serial = Timer.Serial;
+}
+
+void UWSWeaponTimerSubsystem::ClearTimer(FWSWeaponTimerHandle& Handle)
+{
+	if (IsTimerActive(Handle))
+	{
+		// timer waiting for dispatch is not linked, the batch skips it by serial
+		if (Timers[Handle.Index].List != INDEX_NONE)
+		{
+			UnlinkTimer(Handle.Index);
+		}
+
+		FreeTimer(Handle.Index);
+	}
+
+	Handle.Invalidate();
+}
+
+bool UWSWeaponTimerSubsystem::IsTimerActive(const FWSWeaponTimerHandle& Handle) const
+{
+	return Timers.IsValidIndex(Handle.Index) && Timers[Handle.Index].Serial == Handle.Serial;
+}
+
+void UWSWeaponTimerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_WSWeaponTimers);
+	SET_DWORD_STAT(STAT_WSScheduledWeaponTimers, NumTimers);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const int64 TargetTick = GetTick(Now);
+
+	// empty wheel has nothing to move down
+	if (NumTimers == 0)
+	{
+		CurrentTick = FMath::Max(CurrentTick, TargetTick);
+		return;
+	}
+
+	DueTimers.Reset();
+
+	while (true)
+	{
+		CollectDueTimers(static_cast<int32>(CurrentTick & (NumNearSlots - 1)), Now, TargetTick);
+
+		if (CurrentTick >= TargetTick)
+		{
+			break;
+		}
+
+		CurrentTick++;
+
+		// near level turned, move the next far slot down, overflow moves down when the far level turns
+		if ((CurrentTick & (NumNearSlots - 1)) == 0)
+		{
+			const int32 FarSlot = static_cast<int32>((CurrentTick >> NearBits) & (NumFarSlots - 1));
+			if (FarSlot == 0)
+			{
+				Cascade(OverflowList);
+			}
+
+			Cascade(NumNearSlots + FarSlot);
+		}
+	}
+
+	if (DueTimers.Num() == 0)
+	{
+		return;
+	}
+
+	// timers of one tick fire in expire order
+	DueTimers.Sort([this](const FWSWeaponTimerHandle& A, const FWSWeaponTimerHandle& B)
+	{
+		return Timers[A.Index].ExpireTime < Timers[B.Index].ExpireTime;
+	});
+
+	INC_DWORD_STAT_BY(STAT_WSFiredWeaponTimers, DueTimers.Num());
+
+	for (const FWSWeaponTimerHandle& Handle : DueTimers)
+	{
+		// earlier timer of the batch could clear or replace this one
+		if (!IsTimerActive(Handle))
+		{
+			continue;
+		}
+
+		// pool can grow while weapon sets new timers
+		FWSWeaponTimer& Timer = Timers[Handle.Index];
+		AWSWeapon* Weapon = Timer.Weapon.Get();
+		const FWSWeaponTimerFunc Func = Timer.Func;
+
+		FreeTimer(Handle.Index);
+
+		if (Weapon)
+		{
+			(Weapon->*Func)();
+		}
+	}
+}
+
+void UWSWeaponTimerSubsystem::CollectDueTimers(int32 List, double Now, int64 LastTick)
+{
+	int32 Index = ListHeads[List];
+	while (Index != INDEX_NONE)
+	{
+		FWSWeaponTimer& Timer = Timers[Index];
+		const int32 NextIndex = Timer.Next;
+
+		if (Timer.ExpireTime <= Now)
+		{
+			UnlinkTimer(Index);
+			DueTimers.Add({Index, Timer.Serial});
+		}
+		else if (Timer.Tick < LastTick)
+		{
+			// rounded into a slot the wheel is passing, keep it in the slot of this tick
+			UnlinkTimer(Index);
+			Timer.Tick = LastTick;
+			Schedule(Index);
+		}
+
+		Index = NextIndex;
+	}
+}
+
+void UWSWeaponTimerSubsystem::Schedule(int32 Index)
+{
+	FWSWeaponTimer& Timer = Timers[Index];
+	Timer.Tick = FMath::Max(Timer.Tick, CurrentTick);
+
+	int32 List = OverflowList;
+	if (Timer.Tick - CurrentTick < NumNearSlots)
+	{
+		List = static_cast<int32>(Timer.Tick & (NumNearSlots - 1));
+	}
+	else if ((Timer.Tick >> NearBits) - (CurrentTick >> NearBits) < NumFarSlots)
+	{
+		List = NumNearSlots + static_cast<int32>((Timer.Tick >> NearBits) & (NumFarSlots - 1));
+	}
+
+	LinkTimer(Index, List);
+}
+
+void UWSWeaponTimerSubsystem::Cascade(int32 List)
+{
+	int32 Index = ListHeads[List];
+	ListHeads[List] = INDEX_NONE;
+
+	while (Index != INDEX_NONE)
+	{
+		const int32 NextIndex = Timers[Index].Next;
+		Schedule(Index);
+		Index = NextIndex;
+	}
+}
+
+void UWSWeaponTimerSubsystem::LinkTimer(int32 Index, int32 List)
+{
+	FWSWeaponTimer& Timer = Timers[Index];
+	Timer.List = List;
+	Timer.Prev = INDEX_NONE;
+	Timer.Next = ListHeads[List];
+
+	if (Timer.Next != INDEX_NONE)
+	{
+		Timers[Timer.Next].Prev = Index;
+	}
+
+	ListHeads[List] = Index;
+}
+
+void UWSWeaponTimerSubsystem::UnlinkTimer(int32 Index)
+{
+	FWSWeaponTimer& Timer = Timers[Index];
+
+	if (Timer.Prev != INDEX_NONE)
+	{
+		Timers[Timer.Prev].Next = Timer.Next;
+	}
+	else
+	{
+		ListHeads[Timer.List] = Timer.Next;
+	}
+
+	if (Timer.Next != INDEX_NONE)
+	{
+		Timers[Timer.Next].Prev = Timer.Prev;
+	}
+
+	Timer.List = INDEX_NONE;
+	Timer.Prev = INDEX_NONE;
+	Timer.Next = INDEX_NONE;
+}
+
+int32 UWSWeaponTimerSubsystem::AllocateTimer()
+{
+	int32 Index = FreeHead;
+	if (Index == INDEX_NONE)
+	{
+		Index = Timers.AddZeroed();
+		Timers[Index].Serial = 1;
+	}
+	else
+	{
+		FreeHead = Timers[Index].Next;
+	}
+
+	FWSWeaponTimer& Timer = Timers[Index];
+	Timer.List = INDEX_NONE;
+	Timer.Prev = INDEX_NONE;
+	Timer.Next = INDEX_NONE;
+
+	NumTimers++;
+	return Index;
+}
+
+void UWSWeaponTimerSubsystem::FreeTimer(int32 Index)
+{
+	FWSWeaponTimer& Timer = Timers[Index];
+	Timer.Weapon.Reset();
+	Timer.Func = nullptr;
+	Timer.List = INDEX_NONE;
+	Timer.Prev = INDEX_NONE;
+	Timer.Next = FreeHead;
+
+	// invalidate handles, zero is never used
+	Timer.Serial = FMath::Max(Timer.Serial + 1, 1u);
+
+	FreeHead = Index;
+	NumTimers--;
+}
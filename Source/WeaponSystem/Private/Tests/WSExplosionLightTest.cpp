@@ -0,0 +1,83 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "Subsystems/WSExplosionLightSubsystem.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace WSExplosionLightTest
+{
+	static FWSActiveExplosionLight MakeLight(int32 LightIndex, double StartTime, const FVector& Location, float Intensity = 500.0f)
+	{
+		FWSActiveExplosionLight Light;
+		Light.LightIndex = LightIndex;
+		Light.Intensity = Intensity;
+		Light.AttenuationRadius = 400.0f;
+		Light.FadeOut = 0.2f;
+		Light.StartTime = StartTime;
+		Light.Location = Location;
+		return Light;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWSExplosionLightEvictionTest, "WeaponSystem.Effects.ExplosionLightEviction", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWSExplosionLightEvictionTest::RunTest(const FString& Parameters)
+{
+	using namespace WSExplosionLightTest;
+
+	const FVector ViewLocation = FVector::ZeroVector;
+	const FVector NearLocation(1000.0f, 0.0f, 0.0f);
+	const FVector FarLocation(8000.0f, 0.0f, 0.0f);
+
+	// new light isn't scored as dark while its fade starts from zero
+	const double Now = 10.0;
+	TestTrue(TEXT("New light outranks older light"),
+		UWSExplosionLightSubsystem::GetLightImportance(MakeLight(0, Now, NearLocation), ViewLocation, Now) >
+		UWSExplosionLightSubsystem::GetLightImportance(MakeLight(1, Now - 0.1, NearLocation), ViewLocation, Now));
+
+	// burst of explosions keeps the freshest lights up to the cap
+	const int32 MaxActiveLights = 4;
+	const int32 NumExplosions = 10;
+	TArray<FWSActiveExplosionLight> ActiveLights;
+	for (int32 Explosion = 0; Explosion < NumExplosions; Explosion++)
+	{
+		const double Time = Now + Explosion * 0.01;
+		const FWSActiveExplosionLight NewLight = MakeLight(Explosion, Time, NearLocation);
+
+		if (ActiveLights.Num() >= MaxActiveLights)
+		{
+			const int32 EvictIndex = UWSExplosionLightSubsystem::FindLightToEvict(ActiveLights, NewLight, ViewLocation, Time);
+			if (!TestNotEqual(TEXT("Fresh light replaces an older one"), EvictIndex, static_cast<int32>(INDEX_NONE)))
+			{
+				return false;
+			}
+
+			TestEqual(TEXT("Oldest light is evicted"), ActiveLights[EvictIndex].LightIndex, Explosion - MaxActiveLights);
+			ActiveLights.RemoveAtSwap(EvictIndex, 1, false);
+		}
+
+		ActiveLights.Add(NewLight);
+		TestTrue(TEXT("Cap is kept"), ActiveLights.Num() <= MaxActiveLights);
+	}
+
+	for (const FWSActiveExplosionLight& Light : ActiveLights)
+	{
+		TestTrue(FString::Printf(TEXT("Light %d is one of the newest"), Light.LightIndex), Light.LightIndex >= NumExplosions - MaxActiveLights);
+	}
+
+	// far dim light doesn't replace near ones
+	const double LastTime = Now + NumExplosions * 0.01;
+	const FWSActiveExplosionLight FarLight = MakeLight(NumExplosions, LastTime, FarLocation, 100.0f);
+	TestEqual(TEXT("Far dim light is dropped"), UWSExplosionLightSubsystem::FindLightToEvict(ActiveLights, FarLight, ViewLocation, LastTime), static_cast<int32>(INDEX_NONE));
+
+	// near light replaces a far one regardless of age
+	ActiveLights[0].Location = FarLocation;
+	ActiveLights[0].StartTime = LastTime;
+	const FWSActiveExplosionLight NearLight = MakeLight(NumExplosions + 1, LastTime, NearLocation);
+	TestEqual(TEXT("Far light is evicted first"), UWSExplosionLightSubsystem::FindLightToEvict(ActiveLights, NearLight, ViewLocation, LastTime), 0);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
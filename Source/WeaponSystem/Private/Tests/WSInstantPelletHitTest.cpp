@@ -0,0 +1,65 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "WSWeapon_Instant.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/CoreNet.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWSInstantPelletHitSizeTest, "WeaponSystem.Net.InstantPelletHit", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWSInstantPelletHitSizeTest::RunTest(const FString& Parameters)
+{
+	// world hit, no objects are written so the map doesn't need a connection
+	UPackageMap* Map = NewObject<UPackageMap>();
+
+	const FVector TraceStart(1200.0f, -350.0f, 180.0f);
+	const FVector TraceEnd(9200.0f, 1650.0f, 80.0f);
+
+	FHitResult Impact(TraceStart, TraceEnd);
+	Impact.bBlockingHit = true;
+	Impact.Location = FVector(4321.56f, 654.32f, 130.17f);
+	Impact.ImpactPoint = FVector(4325.11f, 655.2f, 130.04f);
+	Impact.ImpactNormal = FVector(-0.6f, 0.0f, 0.8f);
+	Impact.Normal = Impact.ImpactNormal;
+	Impact.Distance = FVector::Dist(TraceStart, Impact.Location);
+	Impact.Time = Impact.Distance / FVector::Dist(TraceStart, TraceEnd);
+
+	FInstantPelletHit PelletHit(7, Impact);
+	PelletHit.BoneIndex = 42;
+
+	bool bSuccess = false;
+
+	FNetBitWriter HitResultWriter(Map, 0);
+	Impact.NetSerialize(HitResultWriter, Map, bSuccess);
+	TestTrue(TEXT("FHitResult serialized"), bSuccess && !HitResultWriter.IsError());
+
+	FNetBitWriter PelletHitWriter(Map, 0);
+	PelletHit.NetSerialize(PelletHitWriter, Map, bSuccess);
+	TestTrue(TEXT("FInstantPelletHit serialized"), bSuccess && !PelletHitWriter.IsError());
+
+	const int64 HitResultBits = HitResultWriter.GetNumBits();
+	const int64 PelletHitBits = PelletHitWriter.GetNumBits();
+	AddInfo(FString::Printf(TEXT("FHitResult: %lld bits, FInstantPelletHit: %lld bits"), HitResultBits, PelletHitBits));
+
+	TestTrue(TEXT("Pellet hit is smaller than hit result"), PelletHitBits < HitResultBits);
+	TestTrue(TEXT("Pellet hit fits 18 bytes"), PelletHitBits <= 18 * 8);
+
+	// round trip keeps what server needs within quantization
+	FNetBitReader Reader(Map, PelletHitWriter.GetData(), PelletHitBits);
+	FInstantPelletHit Received;
+	Received.NetSerialize(Reader, Map, bSuccess);
+	TestTrue(TEXT("FInstantPelletHit deserialized"), bSuccess && !Reader.IsError());
+
+	TestEqual(TEXT("Pellet index"), Received.PelletIndex, PelletHit.PelletIndex);
+	TestEqual(TEXT("Blocking hit"), Received.bBlockingHit, PelletHit.bBlockingHit);
+	TestEqual(TEXT("Bone index"), Received.BoneIndex, PelletHit.BoneIndex);
+	TestEqual(TEXT("Surface type"), Received.SurfaceType.GetValue(), PelletHit.SurfaceType.GetValue());
+	TestTrue(TEXT("Location"), Received.Location.Equals(PelletHit.Location, 0.1));
+	TestTrue(TEXT("Impact point"), Received.ImpactPoint.Equals(PelletHit.ImpactPoint, 0.1));
+	TestTrue(TEXT("Impact normal"), Received.ImpactNormal.Equals(PelletHit.ImpactNormal, 0.01));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,71 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "WSWeapon_Instant.h"
+#include "WSTypes.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/CoreNet.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWSShotSeedTest, "WeaponSystem.Net.ShotSeed", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWSShotSeedTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumPellets = 8;
+	const float ConeHalfAngle = FMath::DegreesToRadians(5.0f * 0.5f);
+
+	// client state: seed base replicated from server, burst and shot of the report
+	const int32 SeedBase = 0x2F6B19C3;
+	uint8 BurstId = 37;
+	uint16 ShotIndex = 5;
+	FVector_NetQuantizeNormal AimDir = FVector(0.62f, -0.31f, 0.12f).GetSafeNormal();
+
+	const int32 ClientSeed = AWSWeapon_Instant::MakeShotSeed(SeedBase, BurstId, ShotIndex);
+
+	TArray<FVector> ClientDirs;
+	for (int32 PelletIdx = 0; PelletIdx < NumPellets; PelletIdx++)
+	{
+		ClientDirs.Add(FWSShotRandom::VRandCone(AimDir, ConeHalfAngle, static_cast<uint32>(ClientSeed), PelletIdx));
+	}
+
+	// send what the server derives the seed from
+	UPackageMap* Map = NewObject<UPackageMap>();
+	bool bSuccess = false;
+
+	FNetBitWriter Writer(Map, 0);
+	AimDir.NetSerialize(Writer, Map, bSuccess);
+	Writer << BurstId;
+	Writer << ShotIndex;
+	TestTrue(TEXT("Report serialized"), bSuccess && !Writer.IsError());
+
+	FNetBitReader Reader(Map, Writer.GetData(), Writer.GetNumBits());
+	FVector_NetQuantizeNormal ServerAimDir;
+	uint8 ServerBurstId = 0;
+	uint16 ServerShotIndex = 0;
+	ServerAimDir.NetSerialize(Reader, Map, bSuccess);
+	Reader << ServerBurstId;
+	Reader << ServerShotIndex;
+	TestTrue(TEXT("Report deserialized"), bSuccess && !Reader.IsError());
+
+	// server side, separate process state must not matter
+	const int32 ServerSeed = AWSWeapon_Instant::MakeShotSeed(SeedBase, ServerBurstId, ServerShotIndex);
+	TestEqual(TEXT("Client and server seeds"), ServerSeed, ClientSeed);
+
+	for (int32 PelletIdx = 0; PelletIdx < NumPellets; PelletIdx++)
+	{
+		const FVector ServerDir = FWSShotRandom::VRandCone(ServerAimDir, ConeHalfAngle, static_cast<uint32>(ServerSeed), PelletIdx);
+
+		// only the aim quantization differs
+		const double AngleDeg = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(ServerDir | ClientDirs[PelletIdx], -1.0, 1.0)));
+		TestTrue(FString::Printf(TEXT("Pellet %d direction matches (%.4f deg)"), PelletIdx, AngleDeg), AngleDeg < 0.05);
+	}
+
+	// other owner, other burst or other shot gets another spread
+	TestNotEqual(TEXT("Seed depends on seed base"), AWSWeapon_Instant::MakeShotSeed(SeedBase + 1, BurstId, ShotIndex), ClientSeed);
+	TestNotEqual(TEXT("Seed depends on burst"), AWSWeapon_Instant::MakeShotSeed(SeedBase, BurstId + 1, ShotIndex), ClientSeed);
+	TestNotEqual(TEXT("Seed depends on shot"), AWSWeapon_Instant::MakeShotSeed(SeedBase, BurstId, ShotIndex + 1), ClientSeed);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,128 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "WSWeaponSimCore.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace WSWeaponSimCoreTest
+{
+	/** equipped weapon with full clip, trigger held */
+	static FWeaponSimState MakeFiringState(const FWeaponSimCore& Core)
+	{
+		FWeaponSimState State;
+		State.bIsEquipped = true;
+		State.bWantsToFire = true;
+		State.Ammo = Core.Config.MaxAmmo;
+		State.AmmoInClip = Core.Config.AmmoPerClip;
+		return State;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWSWeaponSimCoreStateTest, "WeaponSystem.SimCore.States", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FWSWeaponSimCoreStateTest::RunTest(const FString& Parameters)
+{
+	using namespace WSWeaponSimCoreTest;
+
+	FWeaponSimCore Core;
+	Core.Config.AmmoPerClip = 5;
+	Core.Config.MaxAmmo = 20;
+	Core.Config.TimeBetweenShots = 0.1f;
+	Core.Config.ReloadDuration = 1.0f;
+
+	// transition events
+	TestEqual(TEXT("Idle -> Firing starts burst"), FWeaponSimCore::GetTransitionEvents(EWeaponSimState::Idle, EWeaponSimState::Firing), EWeaponSimEvent::BurstStarted);
+	TestEqual(TEXT("Firing -> Idle finishes burst"), FWeaponSimCore::GetTransitionEvents(EWeaponSimState::Firing, EWeaponSimState::Idle), EWeaponSimEvent::BurstFinished);
+	TestEqual(TEXT("Firing -> Reloading finishes burst"), FWeaponSimCore::GetTransitionEvents(EWeaponSimState::Firing, EWeaponSimState::Reloading), EWeaponSimEvent::BurstFinished);
+	TestEqual(TEXT("Reloading -> Firing starts burst"), FWeaponSimCore::GetTransitionEvents(EWeaponSimState::Reloading, EWeaponSimState::Firing), EWeaponSimEvent::BurstStarted);
+	TestEqual(TEXT("Idle -> Reloading has no events"), FWeaponSimCore::GetTransitionEvents(EWeaponSimState::Idle, EWeaponSimState::Reloading), EWeaponSimEvent::None);
+
+	FWeaponSimState State = MakeFiringState(Core);
+
+	// unequipped weapon stays idle
+	State.bIsEquipped = false;
+	TestEqual(TEXT("Unequipped weapon is idle"), Core.DetermineState(State), EWeaponSimState::Idle);
+	State.bIsEquipped = true;
+
+	// Idle -> Firing, first shot of the first burst isn't delayed
+	const double BurstStartTime = State.Time + Core.Config.FixedStep;
+	int32 NumFired = Core.Simulate(State, Core.Config.FixedStep);
+	TestEqual(TEXT("Held trigger starts firing"), State.State, EWeaponSimState::Firing);
+	TestEqual(TEXT("First shot is fired when burst starts"), NumFired, 1);
+	TestTrue(TEXT("First shot is at burst start"), FMath::IsNearlyEqual(State.LastFireTime, BurstStartTime, UE_KINDA_SMALL_NUMBER));
+
+	// Firing -> Reloading once the clip is empty
+	NumFired += Core.Simulate(State, 0.6f);
+	TestEqual(TEXT("Whole clip is fired"), NumFired, Core.Config.AmmoPerClip);
+	TestEqual(TEXT("Clip is empty"), State.AmmoInClip, 0);
+	TestEqual(TEXT("Empty clip starts reload"), State.State, EWeaponSimState::Reloading);
+	TestTrue(TEXT("Reload is pending"), State.bPendingReload);
+
+	// Reloading -> Firing after reload duration
+	NumFired = Core.Simulate(State, Core.Config.ReloadDuration);
+	TestFalse(TEXT("Reload is finished"), State.bPendingReload);
+	TestEqual(TEXT("Held trigger fires after reload"), State.State, EWeaponSimState::Firing);
+	TestEqual(TEXT("Clip is refilled"), State.AmmoInClip, Core.Config.AmmoPerClip - NumFired);
+	TestEqual(TEXT("Ammo is consumed"), State.Ammo, Core.Config.MaxAmmo - Core.Config.AmmoPerClip - NumFired);
+
+	// Firing -> Idle on trigger release
+	State.bWantsToFire = false;
+	TestEqual(TEXT("Released trigger fires nothing"), Core.Simulate(State, Core.Config.FixedStep), 0);
+	TestEqual(TEXT("Released trigger stops firing"), State.State, EWeaponSimState::Idle);
+
+	// catch up after a long frame, limited by max shots per update
+	FWeaponSimState CatchupState;
+	CatchupState.NextShotTime = 0.0;
+	TestEqual(TEXT("Due shots after long frame"), Core.GetDueShots(CatchupState, 0.35), 4);
+
+	Core.Config.MaxShotsPerUpdate = 2;
+	CatchupState.NextShotTime = 0.0;
+	TestEqual(TEXT("Due shots are limited"), Core.GetDueShots(CatchupState, 0.35), 2);
+	TestTrue(TEXT("Dropped shots are skipped"), FMath::IsNearlyEqual(CatchupState.NextShotTime, 0.25, UE_KINDA_SMALL_NUMBER));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FWSWeaponSimCoreBenchmark, "WeaponSystem.SimCore.Benchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FWSWeaponSimCoreBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace WSWeaponSimCoreTest;
+
+	const int32 NumWeapons = 1000;
+	const int32 NumFrames = 600;
+	const float FrameTime = 1.0f / 60.0f;
+
+	FWeaponSimCore Core;
+	Core.Config.TimeBetweenShots = 0.05f;
+
+	// half of weapons fire and reload through the whole run, the rest run out of ammo
+	TArray<FWeaponSimState> States;
+	States.Init(MakeFiringState(Core), NumWeapons);
+	for (int32 Index = 0; Index < NumWeapons; Index++)
+	{
+		States[Index].bInfiniteClip = Index % 2 == 0;
+	}
+
+	int64 NumFired = 0;
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		for (FWeaponSimState& State : States)
+		{
+			NumFired += Core.Simulate(State, FrameTime);
+		}
+	}
+
+	const double Elapsed = FMath::Max(FPlatformTime::Seconds() - StartTime, UE_SMALL_NUMBER);
+	AddInfo(FString::Printf(TEXT("%d weapons, %d frames: %lld shots in %.3f ms, %.0f shots per second, %.3f us per weapon update"),
+		NumWeapons, NumFrames, NumFired, Elapsed * 1000.0, NumFired / Elapsed, Elapsed * 1000000.0 / (NumWeapons * NumFrames)));
+
+	TestTrue(TEXT("Weapons fired"), NumFired > 0);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,41 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "WSTypes.h"
+
+uint32 FWSNetQuantize::EncodeOctahedralNormal(const FVector& Normal, int32 BitsPerComponent)
+{
+	const FVector N = Normal.GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+	const double InvL1Norm = 1.0 / (FMath::Abs(N.X) + FMath::Abs(N.Y) + FMath::Abs(N.Z));
+
+	// project on octahedron, fold lower hemisphere over the upper one
+	double U = N.X * InvL1Norm;
+	double V = N.Y * InvL1Norm;
+	if (N.Z < 0.0)
+	{
+		const double FoldedU = (1.0 - FMath::Abs(V)) * (U >= 0.0 ? 1.0 : -1.0);
+		const double FoldedV = (1.0 - FMath::Abs(U)) * (V >= 0.0 ? 1.0 : -1.0);
+		U = FoldedU;
+		V = FoldedV;
+	}
+
+	const uint32 MaxValue = (1u << BitsPerComponent) - 1;
+	const uint32 QuantizedU = static_cast<uint32>(FMath::RoundToInt((U * 0.5 + 0.5) * MaxValue));
+	const uint32 QuantizedV = static_cast<uint32>(FMath::RoundToInt((V * 0.5 + 0.5) * MaxValue));
+
+	return (QuantizedU << BitsPerComponent) | QuantizedV;
+}
+
+FVector FWSNetQuantize::DecodeOctahedralNormal(uint32 Packed, int32 BitsPerComponent)
+{
+	const uint32 MaxValue = (1u << BitsPerComponent) - 1;
+	const double U = ((Packed >> BitsPerComponent) & MaxValue) / static_cast<double>(MaxValue) * 2.0 - 1.0;
+	const double V = (Packed & MaxValue) / static_cast<double>(MaxValue) * 2.0 - 1.0;
+
+	// unfold lower hemisphere
+	FVector N(U, V, 1.0 - FMath::Abs(U) - FMath::Abs(V));
+	const double Fold = FMath::Max(-N.Z, 0.0);
+	N.X += N.X >= 0.0 ? -Fold : Fold;
+	N.Y += N.Y >= 0.0 ? -Fold : Fold;
+
+	return N.GetSafeNormal();
+}
@@ -6,11 +6,16 @@
 #include "WeaponSystem.h"
 #include "Components/AudioComponent.h"
 #include "Components/SphereComponent.h"
+#include "Components/WSWeaponComponent.h"
 #include "Effects/WSExplosionEffect.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "Particles/ParticleSystemComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "Subsystems/WSProjectilePoolSubsystem.h"
+#include "Subsystems/WSProjectileLODSubsystem.h"
+#include "Subsystems/WSProjectileGuidanceSubsystem.h"
+#include "Subsystems/WSRadialDamageSubsystem.h"
 
 AWSProjectile::AWSProjectile()
 {
@@ -44,6 +49,16 @@ AWSProjectile::AWSProjectile()
 	SetRemoteRoleForBackwardsCompat(ROLE_SimulatedProxy);
 	bReplicates = true;
 	SetReplicatingMovement(true);
+
+	bPooled = false;
+	bInPool = false;
+	bPredicted = false;
+	LODIndex = INDEX_NONE;
+	GuidanceIndex = INDEX_NONE;
+	PoolGeneration = 0;
+	PredictionBlendSpeed = 10.0f;
+	PredictionVisualOffset = FVector::ZeroVector;
+	ReconciledGeneration = INDEX_NONE;
 }
 
 void AWSProjectile::PostInitializeComponents()
@@ -51,6 +66,14 @@ void AWSProjectile::PostInitializeComponents()
 	Super::PostInitializeComponents();
 	
 	MovementComp->OnProjectileStop.AddDynamic(this, &AWSProjectile::OnImpact);
+	SetupFromOwner();
+
+	SetLifeSpan( WeaponConfig.ProjectileLife );
+}
+
+void AWSProjectile::SetupFromOwner()
+{
+	CollisionComp->MoveIgnoreActors.Reset();
 	CollisionComp->MoveIgnoreActors.Add(GetInstigator());
 
 	AWSWeapon_Projectile* OwnerWeapon = Cast<AWSWeapon_Projectile>(GetOwner());
@@ -59,11 +82,37 @@ void AWSProjectile::PostInitializeComponents()
 		OwnerWeapon->ApplyWeaponConfig(WeaponConfig);
 	}
 
-	SetLifeSpan( WeaponConfig.ProjectileLife );
 	MyController = GetInstigatorController();
 }
 
-void AWSProjectile::InitVelocity(FVector& ShootDirection)
+void AWSProjectile::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UWSProjectileLODSubsystem* ProjectileLOD = GetWorld()->GetSubsystem<UWSProjectileLODSubsystem>())
+	{
+		ProjectileLOD->RegisterProjectile(this);
+	}
+
+	RegisterGuidance();
+}
+
+void AWSProjectile::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UWSProjectileLODSubsystem* ProjectileLOD = GetWorld()->GetSubsystem<UWSProjectileLODSubsystem>())
+	{
+		ProjectileLOD->UnregisterProjectile(this);
+	}
+
+	if (UWSProjectileGuidanceSubsystem* ProjectileGuidance = GetWorld()->GetSubsystem<UWSProjectileGuidanceSubsystem>())
+	{
+		ProjectileGuidance->UnregisterProjectile(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AWSProjectile::InitVelocity(const FVector& ShootDirection)
 {
 	if (MovementComp)
 	{
@@ -73,58 +122,286 @@ void AWSProjectile::InitVelocity(FVector& ShootDirection)
 
 void AWSProjectile::OnImpact(const FHitResult& HitResult)
 {
+	// explosion comes with replicated projectile
+	if (bPredicted)
+	{
+		DisableAndDestroy();
+		return;
+	}
+
 	if (GetLocalRole() == ROLE_Authority && !bExploded)
 	{
-		Explode(HitResult);
+		ExplosionInfo = FProjectileExplosionInfo(HitResult);
+		Explode(HitResult, ExplosionInfo.SurfaceType);
 		DisableAndDestroy();
 	}
 }
 
-void AWSProjectile::OnRep_Exploded()
+void AWSProjectile::ActivateFromPool(const FTransform& SpawnTransform, AActor* InOwner, APawn* InInstigator, const FVector& ShootDirection)
 {
-	const FVector ProjDirection = GetActorForwardVector();
+	SetOwner(InOwner);
+	SetInstigator(InInstigator);
+	SetupFromOwner();
 
-	const FVector StartTrace = GetActorLocation() - ProjDirection * 200;
-	const FVector EndTrace = GetActorLocation() + ProjDirection * 150;
-	FHitResult Impact;
-	
-	if (!GetWorld()->LineTraceSingleByChannel(Impact, StartTrace, EndTrace, COLLISION_PROJECTILE, FCollisionQueryParams(SCENE_QUERY_STAT(ProjClient), true, GetInstigator())))
+	bInPool = false;
+	bExploded = false;
+	ExplosionInfo = FProjectileExplosionInfo();
+	PoolGeneration++;
+
+	SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+	ResetProjectile();
+	InitVelocity(ShootDirection);
+	SetLifeSpan(WeaponConfig.ProjectileLife);
+	RegisterGuidance();
+
+	SetNetDormancy(DORM_Awake);
+	ForceNetUpdate();
+}
+
+void AWSProjectile::DeactivateToPool()
+{
+	if (UWSProjectileLODSubsystem* ProjectileLOD = GetWorld()->GetSubsystem<UWSProjectileLODSubsystem>())
 	{
-		// failsafe
-		Impact.ImpactPoint = GetActorLocation();
-		Impact.ImpactNormal = -ProjDirection;
+		ProjectileLOD->UnregisterProjectile(this);
 	}
 
-	Explode(Impact);
+	if (UWSProjectileGuidanceSubsystem* ProjectileGuidance = GetWorld()->GetSubsystem<UWSProjectileGuidanceSubsystem>())
+	{
+		ProjectileGuidance->UnregisterProjectile(this);
+	}
+
+	bInPool = true;
+	SetLifeSpan(0.0f);
+
+	UAudioComponent* ProjAudioComp = FindComponentByClass<UAudioComponent>();
+	if (ProjAudioComp)
+	{
+		ProjAudioComp->Stop();
+	}
+
+	if (ParticleComp)
+	{
+		ParticleComp->DeactivateImmediate();
+	}
+
+	MovementComp->StopMovementImmediately();
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+
+	// hidden state is replicated before the channel goes dormant
+	SetNetDormancy(DORM_DormantAll);
 }
 
-void AWSProjectile::Explode(const FHitResult& Impact)
+void AWSProjectile::LifeSpanExpired()
+{
+	UWSProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UWSProjectilePoolSubsystem>();
+	if (bPooled && ProjectilePool && GetLocalRole() == ROLE_Authority)
+	{
+		ProjectilePool->ReleaseProjectile(this);
+		return;
+	}
+
+	Super::LifeSpanExpired();
+}
+
+void AWSProjectile::InitPredictedProjectile()
+{
+	bPredicted = true;
+	SetReplicates(false);
+}
+
+void AWSProjectile::FastForward(float DeltaTime)
+{
+	if (DeltaTime > 0.0f && MovementComp && MovementComp->UpdatedComponent)
+	{
+		MovementComp->TickComponent(DeltaTime, LEVELTICK_All, nullptr);
+	}
+}
+
+void AWSProjectile::PostNetInit()
+{
+	Super::PostNetInit();
+
+	ReconcilePredictedProjectile();
+}
+
+void AWSProjectile::ReconcilePredictedProjectile()
+{
+	AWSWeapon_Projectile* OwnerWeapon = Cast<AWSWeapon_Projectile>(GetOwner());
+	UWSWeaponComponent* WeaponComponent = OwnerWeapon ? OwnerWeapon->GetWeaponComponent() : nullptr;
+	if (WeaponComponent == nullptr || !WeaponComponent->IsLocallyControlled())
+	{
+		return;
+	}
+
+	// pooled projectile activated in the frame it was created is reconciled by both net init and pool generation
+	if (ReconciledGeneration == PoolGeneration)
+	{
+		return;
+	}
+
+	ReconciledGeneration = PoolGeneration;
+
+	AWSProjectile* PredictedProjectile = OwnerWeapon->TakePredictedProjectile();
+	if (PredictedProjectile)
+	{
+		PredictionVisualOffset = PredictedProjectile->GetActorLocation() - GetActorLocation();
+		PredictedProjectile->Destroy();
+
+		if (ParticleComp)
+		{
+			ParticleComp->AddWorldOffset(PredictionVisualOffset);
+		}
+	}
+}
+
+void AWSProjectile::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (ParticleComp && !PredictionVisualOffset.IsZero())
+	{
+		const FVector NewOffset = FMath::VInterpTo(PredictionVisualOffset, FVector::ZeroVector, DeltaSeconds, PredictionBlendSpeed);
+		ParticleComp->AddWorldOffset(NewOffset - PredictionVisualOffset);
+		PredictionVisualOffset = NewOffset;
+	}
+}
+
+void AWSProjectile::ResetProjectile()
+{
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(true);
+
+	// movement stops simulating after impact
+	MovementComp->SetUpdatedComponent(CollisionComp);
+
+	if (ParticleComp && !PredictionVisualOffset.IsZero())
+	{
+		ParticleComp->AddWorldOffset(-PredictionVisualOffset);
+	}
+	PredictionVisualOffset = FVector::ZeroVector;
+
+	if (ParticleComp)
+	{
+		ParticleComp->SetVisibility(true);
+		if (ParticleComp->bAutoActivate)
+		{
+			ParticleComp->Activate(true);
+		}
+	}
+
+	UAudioComponent* ProjAudioComp = FindComponentByClass<UAudioComponent>();
+	if (ProjAudioComp && ProjAudioComp->bAutoActivate)
+	{
+		ProjAudioComp->Play();
+	}
+
+	// start from full rate with cosmetics on
+	if (UWSProjectileLODSubsystem* ProjectileLOD = GetWorld()->GetSubsystem<UWSProjectileLODSubsystem>())
+	{
+		ProjectileLOD->UnregisterProjectile(this);
+		ProjectileLOD->RegisterProjectile(this);
+	}
+}
+
+void AWSProjectile::RegisterGuidance()
+{
+	// predicted projectiles fly straight until replaced, clients receive steered movement
+	if (!HasAuthority() || bPredicted || WeaponConfig.Guidance == EProjectileGuidance::EPG_None)
+	{
+		return;
+	}
+
+	if (UWSProjectileGuidanceSubsystem* ProjectileGuidance = GetWorld()->GetSubsystem<UWSProjectileGuidanceSubsystem>())
+	{
+		ProjectileGuidance->RegisterProjectile(this);
+	}
+}
+
+void AWSProjectile::SetCosmeticsEnabled(bool bEnabled)
+{
+	if (ParticleComp)
+	{
+		ParticleComp->SetVisibility(bEnabled);
+		ParticleComp->SetComponentTickEnabled(bEnabled);
+	}
+
+	UAudioComponent* ProjAudioComp = FindComponentByClass<UAudioComponent>();
+	if (ProjAudioComp && ProjAudioComp->bAutoActivate)
+	{
+		if (bEnabled)
+		{
+			ProjAudioComp->Play();
+		}
+		else
+		{
+			ProjAudioComp->Stop();
+		}
+	}
+}
+
+void AWSProjectile::OnRep_PoolGeneration()
+{
+	// prewarmed projectile had no owner when it was created, owner and instigator arrive with the activation
+	SetupFromOwner();
+	ResetProjectile();
+	ReconcilePredictedProjectile();
+}
+
+void AWSProjectile::OnRep_Exploded()
+{
+	// projectile reused from the pool
+	if (!ExplosionInfo.bExploded)
+	{
+		return;
+	}
+
+	FHitResult Impact;
+	ExplosionInfo.ToHitResult(Impact);
+
+	Explode(Impact, ExplosionInfo.SurfaceType);
+}
+
+void AWSProjectile::Explode(const FHitResult& Impact, EPhysicalSurface SurfaceType)
 {
 	if (ParticleComp)
 	{
 		ParticleComp->Deactivate();
 	}
 
+	SpawnExplosion(GetWorld(), Impact, WeaponConfig, ExplosionTemplate, this, MyController.Get(), SurfaceType);
+
+	bExploded = true;
+}
+
+void AWSProjectile::SpawnExplosion(UWorld* World, const FHitResult& Impact, const FProjectileWeaponData& Config, TSubclassOf<AWSExplosionEffect> ExplosionTemplate,
+	AActor* DamageCauser, AController* InstigatorController, EPhysicalSurface SurfaceType)
+{
 	// effects and damage origin shouldn't be placed inside mesh at impact point
 	const FVector NudgedImpactLocation = Impact.ImpactPoint + Impact.ImpactNormal * 10.0f;
 
-	if (WeaponConfig.ExplosionDamage > 0 && WeaponConfig.ExplosionRadius > 0 && WeaponConfig.DamageType)
+	if (Config.ExplosionDamage > 0 && Config.ExplosionRadius > 0 && Config.DamageType)
 	{
-		UGameplayStatics::ApplyRadialDamage(this, WeaponConfig.ExplosionDamage, NudgedImpactLocation, WeaponConfig.ExplosionRadius, WeaponConfig.DamageType, TArray<AActor*>(), this, MyController.Get());
+		// simultaneous explosions share overlap and visibility queries
+		UWSRadialDamageSubsystem* RadialDamage = World->GetSubsystem<UWSRadialDamageSubsystem>();
+		if (RadialDamage && RadialDamage->IsBatchingEnabled())
+		{
+			RadialDamage->QueueRadialDamage(Config.ExplosionDamage, NudgedImpactLocation, Config.ExplosionRadius, Config.DamageType, DamageCauser, InstigatorController);
+		}
+		else
+		{
+			UGameplayStatics::ApplyRadialDamage(World, Config.ExplosionDamage, NudgedImpactLocation, Config.ExplosionRadius, Config.DamageType, TArray<AActor*>(), DamageCauser, InstigatorController);
+		}
 	}
 
 	if (ExplosionTemplate)
 	{
 		FTransform const SpawnTransform(Impact.ImpactNormal.Rotation(), NudgedImpactLocation);
-		AWSExplosionEffect* const EffectActor = GetWorld()->SpawnActorDeferred<AWSExplosionEffect>(ExplosionTemplate, SpawnTransform);
-		if (EffectActor)
-		{
-			EffectActor->SurfaceHit = Impact;
-			UGameplayStatics::FinishSpawningActor(EffectActor, SpawnTransform);
-		}
+		AWSExplosionEffect::PlayExplosion(World, ExplosionTemplate, SpawnTransform, Impact, SurfaceType);
 	}
-
-	bExploded = true;
 }
 
 void AWSProjectile::DisableAndDestroy()
@@ -158,5 +435,6 @@ void AWSProjectile::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLif
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 	
-	DOREPLIFETIME(AWSProjectile, bExploded);
+	DOREPLIFETIME(AWSProjectile, ExplosionInfo);
+	DOREPLIFETIME(AWSProjectile, PoolGeneration);
 }
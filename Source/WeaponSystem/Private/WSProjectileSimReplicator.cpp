@@ -0,0 +1,46 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "WSProjectileSimReplicator.h"
+#include "Subsystems/WSProjectileSimSubsystem.h"
+
+AWSProjectileSimReplicator::AWSProjectileSimReplicator()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	bReplicates = true;
+	bAlwaysRelevant = true;
+	SetReplicatingMovement(false);
+	SetHidden(true);
+}
+
+void AWSProjectileSimReplicator::MulticastSpawnProjectiles_Implementation(const TArray<FProjectileSpawnRecord>& SpawnRecords)
+{
+	if (HasAuthority())
+	{
+		return;
+	}
+
+	if (UWSProjectileSimSubsystem* ProjectileSim = GetWorld()->GetSubsystem<UWSProjectileSimSubsystem>())
+	{
+		for (const FProjectileSpawnRecord& SpawnRecord : SpawnRecords)
+		{
+			ProjectileSim->SpawnProjectile(nullptr, SpawnRecord);
+		}
+	}
+}
+
+void AWSProjectileSimReplicator::MulticastExplodeProjectiles_Implementation(const TArray<FProjectileExplosionRecord>& Explosions)
+{
+	if (HasAuthority())
+	{
+		return;
+	}
+
+	if (UWSProjectileSimSubsystem* ProjectileSim = GetWorld()->GetSubsystem<UWSProjectileSimSubsystem>())
+	{
+		for (const FProjectileExplosionRecord& Explosion : Explosions)
+		{
+			ProjectileSim->ExplodeProjectile(Explosion);
+		}
+	}
+}
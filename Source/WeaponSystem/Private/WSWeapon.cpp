@@ -10,6 +10,13 @@
 #include "Kismet/GameplayStatics.h"
 #include "Particles/ParticleSystemComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "GameFramework/GameStateBase.h"
+
+static_assert(static_cast<uint8>(EWeaponState::EWS_Idle) == static_cast<uint8>(EWeaponSimState::Idle) &&
+	static_cast<uint8>(EWeaponState::EWS_Firing) == static_cast<uint8>(EWeaponSimState::Firing) &&
+	static_cast<uint8>(EWeaponState::EWS_Reloading) == static_cast<uint8>(EWeaponSimState::Reloading) &&
+	static_cast<uint8>(EWeaponState::EWS_Equipping) == static_cast<uint8>(EWeaponSimState::Equipping), "EWeaponSimState must match EWeaponState");
 
 // Sets default values
 AWSWeapon::AWSWeapon()
@@ -42,6 +49,18 @@ AWSWeapon::AWSWeapon()
 	CurrentAmmoInClip = 0;
 	BurstCounter = 0;
 	LastFireTime = 0.0f;
+	NextShotTime = 0.0f;
+	CurrentShotTime = 0.0f;
+	CurrentShotAlpha = 1.0f;
+	LastFireUpdateTime = 0.0f;
+	BurstId = 0;
+	LocalBurstShots = 0;
+	LastBurstAckTime = 0.0f;
+	bServerBurstActive = false;
+	ServerBurstShots = 0;
+	ServerBurstStartTime = 0.0;
+	LastReconciledShotTime = 0.0;
+	ServerLastReportedShot = INDEX_NONE;
 
 	PrimaryActorTick.bCanEverTick = true;
 	PrimaryActorTick.TickGroup = TG_PrePhysics;
@@ -60,10 +79,19 @@ void AWSWeapon::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
 
+	SimCore.Config.AmmoPerClip = WeaponConfig.AmmoPerClip;
+	SimCore.Config.MaxAmmo = WeaponConfig.MaxAmmo;
+	SimCore.Config.TimeBetweenShots = WeaponConfig.TimeBetweenShots;
+	SimCore.Config.bAllowCatchup = bAllowAutomaticWeaponCatchup;
+	SimCore.Config.MaxShotsPerUpdate = MaxShotsPerFireUpdate;
+	SimCore.Config.ReloadDuration = WeaponConfig.NoAnimReloadDuration;
+
 	if (WeaponConfig.InitialClips > 0)
 	{
 		CurrentAmmoInClip = WeaponConfig.AmmoPerClip;
 		CurrentAmmo = WeaponConfig.AmmoPerClip * WeaponConfig.InitialClips;
+		MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, CurrentAmmo, this);
+		MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, CurrentAmmoInClip, this);
 	}
 
 	DetachMesh();
@@ -74,6 +102,11 @@ void AWSWeapon::Destroyed()
 	Super::Destroyed();
 
 	StopSimulatingWeaponFire();
+
+	ClearWeaponTimer(TimerHandle_OnEquipFinished);
+	ClearWeaponTimer(TimerHandle_StopReload);
+	ClearWeaponTimer(TimerHandle_ReloadWeapon);
+	ClearWeaponTimer(TimerHandle_HandleFiring);
 }
 
 UWSWeaponComponent* AWSWeapon::GetWeaponComponent() const
@@ -145,16 +178,17 @@ void AWSWeapon::StartFire()
 
 void AWSWeapon::StopFire()
 {
-	if ((GetLocalRole() < ROLE_Authority) && WeaponComponent && WeaponComponent->IsLocallyControlled())
-	{
-		ServerStopFire();
-	}
-
+	// finish the burst first, so its shots reach server while it is still firing
 	if (bWantsToFire)
 	{
 		bWantsToFire = false;
 		DetermineWeaponState();
 	}
+
+	if (IsLocallyControlledClient())
+	{
+		ServerStopFire();
+	}
 }
 
 void AWSWeapon::StartReload(bool bFromReplication)
@@ -167,6 +201,7 @@ void AWSWeapon::StartReload(bool bFromReplication)
 	if (bFromReplication || CanReload())
 	{
 		bPendingReload = true;
+		MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, bPendingReload, this);
 		DetermineWeaponState();
 
 		// pawn animation
@@ -176,10 +211,10 @@ void AWSWeapon::StartReload(bool bFromReplication)
 			PawnAnimDuration = WeaponConfig.NoAnimReloadDuration;
 		}
 
-		GetWorldTimerManager().SetTimer(TimerHandle_StopReload, this, &AWSWeapon::StopReload, PawnAnimDuration, false);
+		SetWeaponTimer(TimerHandle_StopReload, &AWSWeapon::StopReload, PawnAnimDuration);
 		if (GetLocalRole() == ROLE_Authority)
 		{
-			GetWorldTimerManager().SetTimer(TimerHandle_ReloadWeapon, this, &AWSWeapon::ReloadWeapon, FMath::Max(0.1f, PawnAnimDuration - 0.1f), false);
+			SetWeaponTimer(TimerHandle_ReloadWeapon, &AWSWeapon::ReloadWeapon, FMath::Max(0.1f, PawnAnimDuration - 0.1f));
 		}
 
 		// weapon animation
@@ -204,6 +239,7 @@ void AWSWeapon::StopReload()
 	if (CurrentState == EWeaponState::EWS_Reloading)
 	{
 		bPendingReload = false;
+		MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, bPendingReload, this);
 		DetermineWeaponState();
 		WeaponComponent->StopPawnAnimation(PawnReloadAnim);
 	}
@@ -211,22 +247,13 @@ void AWSWeapon::StopReload()
 
 void AWSWeapon::ReloadWeapon()
 {
-	int32 ClipDelta = FMath::Min(WeaponConfig.AmmoPerClip - CurrentAmmoInClip, CurrentAmmo - CurrentAmmoInClip);
-
-	if (HasInfiniteClip())
-	{
-		ClipDelta = WeaponConfig.AmmoPerClip - CurrentAmmoInClip;
-	}
+	FWeaponSimState SimState = GetSimState();
+	SimCore.ReloadWeapon(SimState);
 
-	if (ClipDelta > 0)
-	{
-		CurrentAmmoInClip += ClipDelta;
-	}
-
-	if (HasInfiniteClip())
-	{
-		CurrentAmmo = FMath::Max(CurrentAmmoInClip, CurrentAmmo);
-	}
+	CurrentAmmo = SimState.Ammo;
+	CurrentAmmoInClip = SimState.AmmoInClip;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, CurrentAmmo, this);
+	MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, CurrentAmmoInClip, this);
 
 	if (WeaponComponent->IsLocallyControlled())
 	{
@@ -246,9 +273,11 @@ void AWSWeapon::ClientStartReload_Implementation()
 
 void AWSWeapon::GiveAmmo(int AddAmount)
 {
-	const int32 MissingAmmo = FMath::Max(0, WeaponConfig.MaxAmmo - CurrentAmmo);
-	AddAmount = FMath::Min(AddAmount, MissingAmmo);
-	CurrentAmmo += AddAmount;
+	FWeaponSimState SimState = GetSimState();
+	SimCore.GiveAmmo(SimState, AddAmount);
+
+	CurrentAmmo = SimState.Ammo;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, CurrentAmmo, this);
 
 	// TODO: Implement for AI 
 
@@ -267,15 +296,13 @@ void AWSWeapon::GiveAmmo(int AddAmount)
 
 void AWSWeapon::UseAmmo()
 {
-	if (!HasInfiniteAmmo())
-	{
-		CurrentAmmoInClip--;
-	}
+	FWeaponSimState SimState = GetSimState();
+	SimCore.UseAmmo(SimState);
 
-	if (!HasInfiniteAmmo() && !HasInfiniteClip())
-	{
-		CurrentAmmo--;
-	}
+	CurrentAmmo = SimState.Ammo;
+	CurrentAmmoInClip = SimState.AmmoInClip;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, CurrentAmmo, this);
+	MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, CurrentAmmoInClip, this);
 
 	// @TODO: AI actions
 
@@ -320,10 +347,7 @@ bool AWSWeapon::HasInfiniteClip() const
 
 bool AWSWeapon::CanReload() const
 {
-	const bool bCanReload = (!WeaponComponent || WeaponComponent->CanReload());
-	const bool bGotAmmo = ( CurrentAmmoInClip < WeaponConfig.AmmoPerClip) && (CurrentAmmo - CurrentAmmoInClip > 0 || HasInfiniteClip());
-	const bool bStateOKToReload = ( ( CurrentState ==  EWeaponState::EWS_Idle ) || ( CurrentState == EWeaponState::EWS_Firing) );
-	return ( ( bCanReload == true ) && ( bGotAmmo == true ) && ( bStateOKToReload == true) );
+	return SimCore.CanReload(GetSimState());
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -355,7 +379,7 @@ void AWSWeapon::OnEquip(const AWSWeapon* LastWeapon)
 		EquipStartedTime = GetWorld()->GetTimeSeconds();
 		EquipDuration = Duration;
 
-		GetWorldTimerManager().SetTimer(TimerHandle_OnEquipFinished, this, &AWSWeapon::OnEquipFinished, Duration, false);
+		SetWeaponTimer(TimerHandle_OnEquipFinished, &AWSWeapon::OnEquipFinished, Duration);
 	}
 	else
 	{
@@ -404,9 +428,10 @@ void AWSWeapon::OnUnEquip()
 	{
 		WeaponComponent->StopPawnAnimation(PawnReloadAnim);
 		bPendingReload = false;
+		MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, bPendingReload, this);
 
-		GetWorldTimerManager().ClearTimer(TimerHandle_StopReload);
-		GetWorldTimerManager().ClearTimer(TimerHandle_ReloadWeapon);
+		ClearWeaponTimer(TimerHandle_StopReload);
+		ClearWeaponTimer(TimerHandle_ReloadWeapon);
 	}
 
 	if (bPendingEquip)
@@ -414,7 +439,7 @@ void AWSWeapon::OnUnEquip()
 		WeaponComponent->StopPawnAnimation(PawnEquipAnim);
 		bPendingEquip = false;
 
-		GetWorldTimerManager().ClearTimer(TimerHandle_OnEquipFinished);
+		ClearWeaponTimer(TimerHandle_OnEquipFinished);
 	}
 
 	WeaponComponent->NotifyUnEquipWeapon.Broadcast(WeaponComponent->GetPawn(), this);
@@ -452,56 +477,256 @@ bool AWSWeapon::IsAttachedToPawn() const
 
 bool AWSWeapon::CanFire() const
 {
-	const bool bCanFire = WeaponComponent && WeaponComponent->CanFire();
-	const bool bStateOKToFire = ( ( CurrentState ==  EWeaponState::EWS_Idle ) || ( CurrentState == EWeaponState::EWS_Firing) );	
-	return (( bCanFire == true ) && ( bStateOKToFire == true ) && ( bPendingReload == false ));
+	return SimCore.CanFire(GetSimState());
 }
 
-void AWSWeapon::ServerHandleFiring_Implementation()
+FWeaponSimState AWSWeapon::GetSimState() const
 {
-	const bool bShouldUpdateAmmo = (CurrentAmmoInClip > 0 && CanFire());
+	FWeaponSimState SimState;
+	SimState.State = static_cast<EWeaponSimState>(CurrentState);
+	SimState.Ammo = CurrentAmmo;
+	SimState.AmmoInClip = CurrentAmmoInClip;
+	SimState.bIsEquipped = bIsEquipped;
+	SimState.bPendingEquip = bPendingEquip;
+	SimState.bPendingReload = bPendingReload;
+	SimState.bWantsToFire = bWantsToFire;
+	SimState.bOwnerCanFire = WeaponComponent && WeaponComponent->CanFire();
+	SimState.bOwnerCanReload = !WeaponComponent || WeaponComponent->CanReload();
+	SimState.bInfiniteAmmo = HasInfiniteAmmo();
+	SimState.bInfiniteClip = HasInfiniteClip();
+	SimState.NextShotTime = NextShotTime;
+	SimState.LastFireTime = LastFireTime;
+
+	return SimState;
+}
 
-	HandleFiring();
+void AWSWeapon::ServerStartBurst_Implementation(uint8 InBurstId, double StartTime)
+{
+	const double ServerTime = GetServerWorldTime();
 
-	if (bShouldUpdateAmmo)
+	// first shot can't be in the future or fired before the previous burst allows
+	StartTime = FMath::Clamp(StartTime, ServerTime - MaxBurstStartAge, ServerTime);
+	if (LastReconciledShotTime > 0.0)
 	{
-		// update ammo
+		StartTime = FMath::Max(StartTime, LastReconciledShotTime + WeaponConfig.TimeBetweenShots);
+	}
+
+	BurstId = InBurstId;
+	bServerBurstActive = true;
+	ServerBurstShots = 0;
+	ServerBurstStartTime = StartTime;
+	ServerLastReportedShot = INDEX_NONE;
+
+	ReconcileBurst(InBurstId, 1);
+}
+
+bool AWSWeapon::ServerStartBurst_Validate(uint8 InBurstId, double StartTime)
+{
+	return true;
+}
+
+void AWSWeapon::ServerAckBurst_Implementation(uint8 InBurstId, uint16 ShotCount)
+{
+	ReconcileBurst(InBurstId, ShotCount);
+}
+
+bool AWSWeapon::ServerAckBurst_Validate(uint8 InBurstId, uint16 ShotCount)
+{
+	return true;
+}
+
+void AWSWeapon::ServerEndBurst_Implementation(uint8 InBurstId, uint16 ShotCount)
+{
+	ReconcileBurst(InBurstId, ShotCount);
+
+	if (InBurstId == BurstId)
+	{
+		bServerBurstActive = false;
+	}
+}
+
+bool AWSWeapon::ServerEndBurst_Validate(uint8 InBurstId, uint16 ShotCount)
+{
+	return true;
+}
+
+void AWSWeapon::ReconcileBurst(uint8 InBurstId, int32 ShotCount)
+{
+	// acknowledgements are unreliable and can arrive after the burst end or from the previous burst
+	if (!bServerBurstActive || InBurstId != BurstId)
+	{
+		return;
+	}
+
+	const double ServerTime = GetServerWorldTime();
+
+	// rebuild schedule from the burst start, client can't fire faster than time between shots
+	int32 NumShots = ShotCount;
+	if (WeaponConfig.TimeBetweenShots > 0.0f)
+	{
+		const int32 ScheduledShots = FMath::FloorToInt((ServerTime - ServerBurstStartTime + BurstScheduleTolerance) / WeaponConfig.TimeBetweenShots) + 1;
+		NumShots = FMath::Min(NumShots, ScheduledShots);
+	}
+
+	// reload or stop can reach server before the burst end, ammo is charged in any state
+	// shots over the ammo are not counted, their shot data is rejected
+	for (; ServerBurstShots < NumShots; ServerBurstShots++)
+	{
+		if (CurrentAmmoInClip <= 0 && !HasInfiniteClip() && !HasInfiniteAmmo())
+		{
+			break;
+		}
+
 		UseAmmo();
 
-		// update firing FX on remote clients
-		BurstCounter++;
+		if (CurrentState == EWeaponState::EWS_Firing)
+		{
+			if (GetNetMode() != NM_DedicatedServer)
+			{
+				SimulateWeaponFire();
+			}
+
+			// update firing FX on remote clients
+			BurstCounter++;
+			MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, BurstCounter, this);
+		}
+
+		LastReconciledShotTime = ServerBurstStartTime + ServerBurstShots * WeaponConfig.TimeBetweenShots;
 	}
 }
 
-bool AWSWeapon::ServerHandleFiring_Validate()
+bool AWSWeapon::ConsumeBurstShotReport(uint8 InBurstId, int32 ShotIndex)
 {
+	// shot data proves the shot was fired when its unreliable acknowledgement is lost
+	ReconcileBurst(InBurstId, ShotIndex + 1);
+
+	// shot data is sent in fire order, anything else is a repeat or a shot the server didn't charge
+	if (InBurstId != BurstId || ShotIndex >= ServerBurstShots || ShotIndex <= ServerLastReportedShot)
+	{
+		UE_LOG(LogWeaponSystem, Log, TEXT("%s Rejected client shot data (shot %d of burst %d, %d reconciled)"), *GetNameSafe(this), ShotIndex, InBurstId, ServerBurstShots);
+		return false;
+	}
+
+	ServerLastReportedShot = ShotIndex;
 	return true;
 }
 
+void AWSWeapon::ReportBurstShot()
+{
+	if (LocalBurstShots == 0)
+	{
+		BurstId++;
+		LastBurstAckTime = GetWorld()->GetTimeSeconds();
+
+		ServerStartBurst(BurstId, GetShotServerTime());
+	}
+
+	LocalBurstShots++;
+}
+
+void AWSWeapon::SendBurstAck()
+{
+	LastBurstAckTime = GetWorld()->GetTimeSeconds();
+
+	ServerAckBurst(BurstId, static_cast<uint16>(FMath::Min(LocalBurstShots, static_cast<int32>(MAX_uint16))));
+	FlushBurstBatch();
+}
+
+bool AWSWeapon::IsLocallyControlledClient() const
+{
+	return GetLocalRole() < ROLE_Authority && WeaponComponent && WeaponComponent->IsLocallyControlled();
+}
+
 void AWSWeapon::HandleReFiring()
 {
-	// Update TimerIntervalAdjustment
-	UWorld* MyWorld = GetWorld();
+	// timer fires at most once per frame, weapons faster than the frame rate fire several shots per update
+	FWeaponSimState SimState = GetSimState();
+	const int32 NumShots = SimCore.GetDueShots(SimState, GetWorld()->GetTimeSeconds());
+	NextShotTime = SimState.NextShotTime;
+
+	FireShots(NumShots);
+}
+
+void AWSWeapon::HandleFiring()
+{
+	// first shot of the burst is due right now
+	NextShotTime = GetWorld()->GetTimeSeconds();
+	LastFireUpdateTime = NextShotTime;
 
-	const float SlackTimeThisFrame = FMath::Max(0.0f, (MyWorld->TimeSeconds - LastFireTime) - WeaponConfig.TimeBetweenShots);
+	FireShots(1);
+}
+
+void AWSWeapon::FireShots(int32 NumShots)
+{
+	const float GameTime = GetWorld()->GetTimeSeconds();
+	const float UpdateDuration = GameTime - LastFireUpdateTime;
 
-	if (bAllowAutomaticWeaponCatchup)
+	for (int32 ShotIdx = 0; ShotIdx < NumShots; ShotIdx++)
 	{
-		TimerIntervalAdjustment -= SlackTimeThisFrame;
+		// shots keep their due time and muzzle position between the previous update and now
+		CurrentShotTime = FMath::Min(NextShotTime, GameTime);
+		CurrentShotAlpha = UpdateDuration > 0.0f ? FMath::Clamp((CurrentShotTime - LastFireUpdateTime) / UpdateDuration, 0.0f, 1.0f) : 1.0f;
+
+		const bool bFired = FireShot();
+
+		LastFireTime = CurrentShotTime;
+		NextShotTime += WeaponConfig.TimeBetweenShots;
+
+		if (!bFired)
+		{
+			break;
+		}
+	}
+
+	CurrentShotTime = GameTime;
+	CurrentShotAlpha = 1.0f;
+	LastFireUpdateTime = GameTime;
+	if (Mesh)
+	{
+		LastMuzzleTransform = Mesh->GetSocketTransform(WeaponConfig.MuzzleAttachPoint);
 	}
 
-	HandleFiring();
+	if (IsReportingBurst() && GameTime - LastBurstAckTime >= BurstAckInterval)
+	{
+		SendBurstAck();
+	}
+
+	if (WeaponComponent && WeaponComponent->IsLocallyControlled())
+	{
+		// reload after firing last round
+		if (CurrentAmmoInClip <= 0 && CanReload())
+		{
+			StartReload();
+		}
+
+		// setup refire timer
+		bRefiring = (CurrentState == EWeaponState::EWS_Firing && WeaponConfig.TimeBetweenShots > 0.0f);
+		if (bRefiring)
+		{
+			SetWeaponTimer(TimerHandle_HandleFiring, &AWSWeapon::HandleReFiring, FMath::Max<float>(NextShotTime - GameTime, SMALL_NUMBER));
+		}
+	}
 }
 
-void AWSWeapon::HandleFiring()
+bool AWSWeapon::FireShot()
 {
-	if ((CurrentAmmoInClip > 0 || HasInfiniteClip() || HasInfiniteAmmo()) && CanFire())
+	bool bFired = false;
+
+	if (SimCore.CanFireShot(GetSimState()))
 	{
+		bFired = true;
+
 		if (GetNetMode() != NM_DedicatedServer)
 		{
 			SimulateWeaponFire();
 		}
 
+		// start the burst on server before the first shot sends any shot data
+		if (IsLocallyControlledClient())
+		{
+			ReportBurstShot();
+		}
+
 		if (WeaponComponent && WeaponComponent->IsLocallyControlled())
 		{
 			FireWeapon();
@@ -510,6 +735,7 @@ void AWSWeapon::HandleFiring()
 			
 			// update firing FX on remote clients if function was called on server
 			BurstCounter++;
+			MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, BurstCounter, this);
 		}
 	}
 	else if (CanReload())
@@ -536,30 +762,7 @@ void AWSWeapon::HandleFiring()
 		OnBurstFinished();
 	}
 
-	if (WeaponComponent && WeaponComponent->IsLocallyControlled())
-	{
-		// local client will notify server
-		if (GetLocalRole() < ROLE_Authority)
-		{
-			ServerHandleFiring();
-		}
-
-		// reload after firing last round
-		if (CurrentAmmoInClip <= 0 && CanReload())
-		{
-			StartReload();
-		}
-
-		// setup refire timer
-		bRefiring = (CurrentState == EWeaponState::EWS_Firing && WeaponConfig.TimeBetweenShots > 0.0f);
-		if (bRefiring)
-		{
-			GetWorldTimerManager().SetTimer(TimerHandle_HandleFiring, this, &AWSWeapon::HandleReFiring, FMath::Max<float>(WeaponConfig.TimeBetweenShots + TimerIntervalAdjustment, SMALL_NUMBER), false);
-			TimerIntervalAdjustment = 0.f;
-		}
-	}
-
-	LastFireTime = GetWorld()->GetTimeSeconds();
+	return bFired;
 }
 
 void AWSWeapon::OnBurstStarted()
@@ -569,7 +772,7 @@ void AWSWeapon::OnBurstStarted()
 	if (LastFireTime > 0 && WeaponConfig.TimeBetweenShots > 0.0f &&
         LastFireTime + WeaponConfig.TimeBetweenShots > GameTime)
 	{
-		GetWorldTimerManager().SetTimer(TimerHandle_HandleFiring, this, &AWSWeapon::HandleFiring, LastFireTime + WeaponConfig.TimeBetweenShots - GameTime, false);
+		SetWeaponTimer(TimerHandle_HandleFiring, &AWSWeapon::HandleFiring, LastFireTime + WeaponConfig.TimeBetweenShots - GameTime);
 	}
 	else
 	{
@@ -579,8 +782,17 @@ void AWSWeapon::OnBurstStarted()
 
 void AWSWeapon::OnBurstFinished()
 {
+	// report the whole burst, shot count of the end is final
+	if (IsReportingBurst())
+	{
+		ServerEndBurst(BurstId, static_cast<uint16>(FMath::Min(LocalBurstShots, static_cast<int32>(MAX_uint16))));
+		FlushBurstBatch();
+		LocalBurstShots = 0;
+	}
+
 	// stop firing FX on remote clients
 	BurstCounter = 0;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon, BurstCounter, this);
 
 	// stop firing FX locally, unless it's a dedicated server
 	//if (GetNetMode() != NM_DedicatedServer)
@@ -588,25 +800,42 @@ void AWSWeapon::OnBurstFinished()
 	StopSimulatingWeaponFire();
 	//}
 	
-	GetWorldTimerManager().ClearTimer(TimerHandle_HandleFiring);
+	ClearWeaponTimer(TimerHandle_HandleFiring);
 	bRefiring = false;
+}
+
+void AWSWeapon::SetWeaponTimer(FWSWeaponTimerHandle& Handle, FWSWeaponTimerFunc Func, float Rate)
+{
+	if (UWSWeaponTimerSubsystem* WeaponTimers = GetWorld()->GetSubsystem<UWSWeaponTimerSubsystem>())
+	{
+		WeaponTimers->SetTimer(Handle, this, Func, Rate);
+	}
+}
 
-	// reset firing interval adjustment
-	TimerIntervalAdjustment = 0.0f;
+void AWSWeapon::ClearWeaponTimer(FWSWeaponTimerHandle& Handle)
+{
+	if (UWSWeaponTimerSubsystem* WeaponTimers = GetWorld()->GetSubsystem<UWSWeaponTimerSubsystem>())
+	{
+		WeaponTimers->ClearTimer(Handle);
+	}
+	else
+	{
+		Handle.Invalidate();
+	}
 }
 
 void AWSWeapon::SetWeaponState(EWeaponState NewState)
 {
-	const EWeaponState PrevState = CurrentState;
+	const EWeaponSimEvent Events = FWeaponSimCore::GetTransitionEvents(static_cast<EWeaponSimState>(CurrentState), static_cast<EWeaponSimState>(NewState));
 
-	if (PrevState == EWeaponState::EWS_Firing && NewState != EWeaponState::EWS_Firing)
+	if (EnumHasAnyFlags(Events, EWeaponSimEvent::BurstFinished))
 	{
 		OnBurstFinished();
 	}
 
 	CurrentState = NewState;
 
-	if (PrevState != EWeaponState::EWS_Firing && NewState == EWeaponState::EWS_Firing)
+	if (EnumHasAnyFlags(Events, EWeaponSimEvent::BurstStarted))
 	{
 		OnBurstStarted();
 	}
@@ -614,32 +843,7 @@ void AWSWeapon::SetWeaponState(EWeaponState NewState)
 
 void AWSWeapon::DetermineWeaponState()
 {
-	EWeaponState NewState = EWeaponState::EWS_Idle;
-
-	if (bIsEquipped)
-	{
-		if( bPendingReload  )
-		{
-			if( CanReload() == false )
-			{
-				NewState = CurrentState;
-			}
-			else
-			{
-				NewState = EWeaponState::EWS_Reloading;
-			}
-		}		
-		else if ( (bPendingReload == false ) && ( bWantsToFire == true ) && ( CanFire() == true ))
-		{
-			NewState = EWeaponState::EWS_Firing;
-		}
-	}
-	else if (bPendingEquip)
-	{
-		NewState = EWeaponState::EWS_Equipping;
-	}
-
-	SetWeaponState(NewState);
+	SetWeaponState(static_cast<EWeaponState>(SimCore.DetermineState(GetSimState())));
 }
 
 
@@ -839,23 +1043,56 @@ FVector AWSWeapon::GetDamageStartLocation(const FVector& AimDir) const
 
 FVector AWSWeapon::GetMuzzleLocation() const
 {
-	return Mesh ? Mesh->GetSocketLocation(WeaponConfig.MuzzleAttachPoint) : FVector::ZeroVector;
+	if (Mesh == nullptr)
+	{
+		return FVector::ZeroVector;
+	}
+
+	const FVector MuzzleLocation = Mesh->GetSocketLocation(WeaponConfig.MuzzleAttachPoint);
+	return CurrentShotAlpha < 1.0f ? FMath::Lerp(LastMuzzleTransform.GetLocation(), MuzzleLocation, CurrentShotAlpha) : MuzzleLocation;
 }
 
 FVector AWSWeapon::GetMuzzleDirection() const
 {
-	return Mesh ? Mesh->GetSocketRotation(WeaponConfig.MuzzleAttachPoint).Vector() : FVector::ZeroVector;
+	if (Mesh == nullptr)
+	{
+		return FVector::ZeroVector;
+	}
+
+	const FQuat MuzzleRotation = Mesh->GetSocketQuaternion(WeaponConfig.MuzzleAttachPoint);
+	return CurrentShotAlpha < 1.0f ? FQuat::Slerp(LastMuzzleTransform.GetRotation(), MuzzleRotation, CurrentShotAlpha).GetForwardVector() : MuzzleRotation.GetForwardVector();
 }
 
-FHitResult AWSWeapon::WeaponTrace(const FVector& TraceFrom, const FVector& TraceTo) const
+float AWSWeapon::GetShotTimeOffset() const
+{
+	return CurrentShotAlpha < 1.0f ? GetWorld()->GetTimeSeconds() - CurrentShotTime : 0.0f;
+}
+
+double AWSWeapon::GetShotServerTime() const
+{
+	return GetServerWorldTime() - GetShotTimeOffset();
+}
+
+double AWSWeapon::GetServerWorldTime() const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+FCollisionQueryParams AWSWeapon::GetWeaponTraceParams() const
 {
-	// Perform trace to retrieve hit info
 	FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(WeaponTrace), true, WeaponComponent->GetPawn());
 	TraceParams.bReturnPhysicalMaterial = true;
 	TraceParams.bDebugQuery = true;
 
+	return TraceParams;
+}
+
+FHitResult AWSWeapon::WeaponTrace(const FVector& TraceFrom, const FVector& TraceTo) const
+{
+	// Perform trace to retrieve hit info
 	FHitResult Hit(ForceInit);
-	GetWorld()->LineTraceSingleByChannel(Hit, TraceFrom, TraceTo, COLLISION_WEAPON, TraceParams);
+	GetWorld()->LineTraceSingleByChannel(Hit, TraceFrom, TraceTo, COLLISION_WEAPON, GetWeaponTraceParams());
 
 	return Hit;
 }
@@ -866,10 +1103,19 @@ void AWSWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetim
 
 	DOREPLIFETIME(AWSWeapon, WeaponComponent);
 
-	DOREPLIFETIME_CONDITION(AWSWeapon, CurrentAmmo, COND_OwnerOnly);
-	DOREPLIFETIME_CONDITION(AWSWeapon, CurrentAmmoInClip, COND_OwnerOnly);
+	// push model, marked dirty where changed
+	FDoRepLifetimeParams OwnerOnlyParams;
+	OwnerOnlyParams.bIsPushBased = true;
+	OwnerOnlyParams.Condition = COND_OwnerOnly;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(AWSWeapon, CurrentAmmo, OwnerOnlyParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AWSWeapon, CurrentAmmoInClip, OwnerOnlyParams);
+
+	FDoRepLifetimeParams SkipOwnerParams;
+	SkipOwnerParams.bIsPushBased = true;
+	SkipOwnerParams.Condition = COND_SkipOwner;
 
-	DOREPLIFETIME_CONDITION(AWSWeapon, BurstCounter, COND_SkipOwner );
-	DOREPLIFETIME_CONDITION(AWSWeapon, bPendingReload, COND_SkipOwner);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AWSWeapon, BurstCounter, SkipOwnerParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AWSWeapon, bPendingReload, SkipOwnerParams);
 }
 
@@ -0,0 +1,253 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#include "WSWeaponSimCore.h"
+
+namespace WSWeaponSim
+{
+	/** conditions the next state is looked up by */
+	enum ECondition : uint8
+	{
+		Equipped		= 1 << 0,
+		PendingEquip	= 1 << 1,
+		PendingReload	= 1 << 2,
+		ReloadAllowed	= 1 << 3,
+		WantsToFire		= 1 << 4,
+		FireAllowed		= 1 << 5,
+
+		NumConditions	= 1 << 6
+	};
+
+	/** table entry keeping current state */
+	static constexpr uint8 KeepState = static_cast<uint8>(EWeaponSimState::Num);
+
+	/** next state by conditions */
+	struct FStateTable
+	{
+		uint8 NextState[NumConditions];
+
+		FStateTable()
+		{
+			for (uint8 Conditions = 0; Conditions < NumConditions; Conditions++)
+			{
+				EWeaponSimState State = EWeaponSimState::Idle;
+
+				if (Conditions & Equipped)
+				{
+					if (Conditions & PendingReload)
+					{
+						// reload waits until the state allows it
+						if (!(Conditions & ReloadAllowed))
+						{
+							NextState[Conditions] = KeepState;
+							continue;
+						}
+
+						State = EWeaponSimState::Reloading;
+					}
+					else if ((Conditions & WantsToFire) && (Conditions & FireAllowed))
+					{
+						State = EWeaponSimState::Firing;
+					}
+				}
+				else if (Conditions & PendingEquip)
+				{
+					State = EWeaponSimState::Equipping;
+				}
+
+				NextState[Conditions] = static_cast<uint8>(State);
+			}
+		}
+	};
+
+	static const FStateTable StateTable;
+
+	static constexpr EWeaponSimEvent None = EWeaponSimEvent::None;
+	static constexpr EWeaponSimEvent Started = EWeaponSimEvent::BurstStarted;
+	static constexpr EWeaponSimEvent Finished = EWeaponSimEvent::BurstFinished;
+
+	/** events by previous (rows) and new (columns) state */
+	static constexpr EWeaponSimEvent TransitionEvents[static_cast<int32>(EWeaponSimState::Num)][static_cast<int32>(EWeaponSimState::Num)] =
+	{
+		//					Idle		Firing		Reloading	Equipping
+		/* Idle */		{	None,		Started,	None,		None		},
+		/* Firing */	{	Finished,	None,		Finished,	Finished	},
+		/* Reloading */	{	None,		Started,	None,		None		},
+		/* Equipping */	{	None,		Started,	None,		None		},
+	};
+}
+
+EWeaponSimState FWeaponSimCore::DetermineState(const FWeaponSimState& State) const
+{
+	using namespace WSWeaponSim;
+
+	uint8 Conditions = 0;
+	Conditions |= State.bIsEquipped ? Equipped : 0;
+	Conditions |= State.bPendingEquip ? PendingEquip : 0;
+	Conditions |= State.bPendingReload ? PendingReload : 0;
+	Conditions |= CanReload(State) ? ReloadAllowed : 0;
+	Conditions |= State.bWantsToFire ? WantsToFire : 0;
+	Conditions |= CanFire(State) ? FireAllowed : 0;
+
+	const uint8 NextState = StateTable.NextState[Conditions];
+	return NextState == KeepState ? State.State : static_cast<EWeaponSimState>(NextState);
+}
+
+EWeaponSimEvent FWeaponSimCore::SetState(FWeaponSimState& State, EWeaponSimState NewState) const
+{
+	const EWeaponSimEvent Events = GetTransitionEvents(State.State, NewState);
+	State.State = NewState;
+
+	return Events;
+}
+
+EWeaponSimEvent FWeaponSimCore::GetTransitionEvents(EWeaponSimState PrevState, EWeaponSimState NewState)
+{
+	return WSWeaponSim::TransitionEvents[static_cast<int32>(PrevState)][static_cast<int32>(NewState)];
+}
+
+bool FWeaponSimCore::CanFire(const FWeaponSimState& State) const
+{
+	const bool bStateOKToFire = State.State == EWeaponSimState::Idle || State.State == EWeaponSimState::Firing;
+	return State.bOwnerCanFire && bStateOKToFire && !State.bPendingReload;
+}
+
+bool FWeaponSimCore::CanFireShot(const FWeaponSimState& State) const
+{
+	return (State.AmmoInClip > 0 || State.bInfiniteClip || State.bInfiniteAmmo) && CanFire(State);
+}
+
+bool FWeaponSimCore::CanReload(const FWeaponSimState& State) const
+{
+	const bool bGotAmmo = State.AmmoInClip < Config.AmmoPerClip && (State.Ammo - State.AmmoInClip > 0 || State.bInfiniteClip);
+	const bool bStateOKToReload = State.State == EWeaponSimState::Idle || State.State == EWeaponSimState::Firing;
+	return State.bOwnerCanReload && bGotAmmo && bStateOKToReload;
+}
+
+void FWeaponSimCore::UseAmmo(FWeaponSimState& State) const
+{
+	if (!State.bInfiniteAmmo)
+	{
+		State.AmmoInClip--;
+	}
+
+	if (!State.bInfiniteAmmo && !State.bInfiniteClip)
+	{
+		State.Ammo--;
+	}
+}
+
+void FWeaponSimCore::ReloadWeapon(FWeaponSimState& State) const
+{
+	int32 ClipDelta = FMath::Min(Config.AmmoPerClip - State.AmmoInClip, State.Ammo - State.AmmoInClip);
+
+	if (State.bInfiniteClip)
+	{
+		ClipDelta = Config.AmmoPerClip - State.AmmoInClip;
+	}
+
+	if (ClipDelta > 0)
+	{
+		State.AmmoInClip += ClipDelta;
+	}
+
+	if (State.bInfiniteClip)
+	{
+		State.Ammo = FMath::Max(State.AmmoInClip, State.Ammo);
+	}
+}
+
+int32 FWeaponSimCore::GiveAmmo(FWeaponSimState& State, int32 AddAmount) const
+{
+	const int32 MissingAmmo = FMath::Max(0, Config.MaxAmmo - State.Ammo);
+	AddAmount = FMath::Min(AddAmount, MissingAmmo);
+	State.Ammo += AddAmount;
+
+	return AddAmount;
+}
+
+int32 FWeaponSimCore::GetDueShots(FWeaponSimState& State, double Now) const
+{
+	if (!Config.bAllowCatchup || Config.TimeBetweenShots <= 0.0f)
+	{
+		State.NextShotTime = Now;
+		return 1;
+	}
+
+	const int32 MaxShots = FMath::Max(Config.MaxShotsPerUpdate, 1);
+	const int32 NumShots = FMath::Clamp(FMath::FloorToInt32((Now - State.NextShotTime) / Config.TimeBetweenShots) + 1, 1, MaxShots);
+
+	// drop shots over the limit after a long frame instead of firing them over the next updates
+	State.NextShotTime = FMath::Max(State.NextShotTime, Now - (NumShots - 1) * Config.TimeBetweenShots);
+
+	return NumShots;
+}
+
+int32 FWeaponSimCore::Simulate(FWeaponSimState& State, float DeltaTime) const
+{
+	const double FixedStep = FMath::Max<double>(Config.FixedStep, UE_KINDA_SMALL_NUMBER);
+
+	int32 NumFired = 0;
+	State.PendingTime += DeltaTime;
+
+	while (State.PendingTime >= FixedStep)
+	{
+		State.PendingTime -= FixedStep;
+		State.Time += FixedStep;
+
+		NumFired += Step(State);
+	}
+
+	return NumFired;
+}
+
+int32 FWeaponSimCore::Step(FWeaponSimState& State) const
+{
+	if (State.bPendingReload && State.Time >= State.ReloadEndTime)
+	{
+		ReloadWeapon(State);
+		State.bPendingReload = false;
+	}
+
+	// burst waits for time between shots after the previous burst, the first burst fires right away like AWSWeapon::OnBurstStarted
+	if (EnumHasAnyFlags(SetState(State, DetermineState(State)), EWeaponSimEvent::BurstStarted))
+	{
+		State.NextShotTime = State.LastFireTime > 0.0 ? FMath::Max(State.Time, State.LastFireTime + Config.TimeBetweenShots) : State.Time;
+	}
+
+	if (State.State != EWeaponSimState::Firing || State.Time < State.NextShotTime)
+	{
+		return 0;
+	}
+
+	int32 NumFired = 0;
+	const int32 NumShots = GetDueShots(State, State.Time);
+	for (int32 ShotIdx = 0; ShotIdx < NumShots; ShotIdx++)
+	{
+		if (!CanFireShot(State))
+		{
+			break;
+		}
+
+		UseAmmo(State);
+		NumFired++;
+
+		State.LastFireTime = State.NextShotTime;
+		State.NextShotTime += Config.TimeBetweenShots;
+	}
+
+	// reload after firing last round
+	if (State.AmmoInClip <= 0 && CanReload(State))
+	{
+		StartReload(State);
+	}
+
+	return NumFired;
+}
+
+void FWeaponSimCore::StartReload(FWeaponSimState& State) const
+{
+	State.bPendingReload = true;
+	State.ReloadEndTime = State.Time + Config.ReloadDuration;
+
+	SetState(State, DetermineState(State));
+}
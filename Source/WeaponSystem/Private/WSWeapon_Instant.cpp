@@ -2,15 +2,243 @@
 
 #include "WSWeapon_Instant.h"
 #include "WeaponSystem.h"
-#include "Kismet/GameplayStatics.h"
-#include "Particles/ParticleSystemComponent.h"
 #include "Net/UnrealNetwork.h"
 #include "Effects/WSImpactEffect.h"
 #include "Components/WSWeaponComponent.h"
+#include "Subsystems/WSLagCompensationSubsystem.h"
+#include "Subsystems/WSImpactEffectSubsystem.h"
+#include "Subsystems/WSTracerSubsystem.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Engine/NetSerialization.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+// Pellet hit
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace WSPelletHit
+{
+	constexpr int32 PelletIndexBits = 5;
+	constexpr int32 NormalBitsPerComponent = 12;
+	constexpr int32 SurfaceTypeBits = 6;
+
+	enum EFlags : uint8
+	{
+		Flag_BlockingHit = 1 << 0,
+		Flag_HasActor = 1 << 1,
+		Flag_HasImpactPoint = 1 << 2,
+		Flag_HasBone = 1 << 3,
+		NumFlagBits = 4,
+	};
+}
+
+static_assert(FInstantWeaponData::MaxPelletCount <= (1 << WSPelletHit::PelletIndexBits), "Pellet index doesn't fit serialized bits");
+static_assert(SurfaceType_Max <= (1 << WSPelletHit::SurfaceTypeBits), "Surface type doesn't fit serialized bits");
+
+FInstantPelletHit::FInstantPelletHit(uint8 InPelletIndex, const FHitResult& Impact):
+PelletIndex(InPelletIndex),
+bBlockingHit(Impact.bBlockingHit),
+Actor(Impact.GetActor()),
+Location(Impact.Location),
+ImpactPoint(Impact.ImpactPoint),
+ImpactNormal(Impact.ImpactNormal),
+BoneIndex(INDEX_NONE),
+SurfaceType(UPhysicalMaterial::DetermineSurfaceType(Impact.PhysMaterial.Get()))
+{
+	const USkinnedMeshComponent* SkinnedMesh = Cast<USkinnedMeshComponent>(Impact.GetComponent());
+	if (SkinnedMesh && Impact.BoneName != NAME_None)
+	{
+		const int32 HitBoneIndex = SkinnedMesh->GetBoneIndex(Impact.BoneName);
+		BoneIndex = HitBoneIndex <= MAX_int16 ? static_cast<int16>(HitBoneIndex) : INDEX_NONE;
+	}
+}
+
+void FInstantPelletHit::ToHitResult(const FVector& TraceStart, const FVector& TraceEnd, FHitResult& OutImpact) const
+{
+	OutImpact = FHitResult(TraceStart, TraceEnd);
+	OutImpact.bBlockingHit = bBlockingHit;
+	OutImpact.Location = Location;
+	OutImpact.ImpactPoint = ImpactPoint;
+	OutImpact.Normal = ImpactNormal;
+	OutImpact.ImpactNormal = ImpactNormal;
+	OutImpact.Distance = FVector::Dist(TraceStart, Location);
+	OutImpact.Time = OutImpact.Distance / FMath::Max(FVector::Dist(TraceStart, TraceEnd), UE_KINDA_SMALL_NUMBER);
+
+	AActor* HitActor = Actor.Get();
+	if (HitActor == nullptr)
+	{
+		return;
+	}
+
+	OutImpact.HitObjectHandle = FActorInstanceHandle(HitActor);
+
+	// resolve component from the bone, otherwise assume the root was hit
+	USkinnedMeshComponent* SkinnedMesh = BoneIndex != INDEX_NONE ? HitActor->FindComponentByClass<USkinnedMeshComponent>() : nullptr;
+	if (SkinnedMesh)
+	{
+		OutImpact.Component = SkinnedMesh;
+		OutImpact.BoneName = SkinnedMesh->GetBoneName(BoneIndex);
+	}
+	else
+	{
+		OutImpact.Component = Cast<UPrimitiveComponent>(HitActor->GetRootComponent());
+	}
+}
+
+bool FInstantPelletHit::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 Flags = 0;
+	if (Ar.IsSaving())
+	{
+		Flags |= bBlockingHit ? WSPelletHit::Flag_BlockingHit : 0;
+		Flags |= Actor.IsValid() ? WSPelletHit::Flag_HasActor : 0;
+		Flags |= !ImpactPoint.Equals(Location, 0.1) ? WSPelletHit::Flag_HasImpactPoint : 0;
+		Flags |= BoneIndex != INDEX_NONE ? WSPelletHit::Flag_HasBone : 0;
+	}
+
+	Ar.SerializeBits(&Flags, WSPelletHit::NumFlagBits);
+	Ar.SerializeBits(&PelletIndex, WSPelletHit::PelletIndexBits);
+
+	bOutSuccess = true;
+	bBlockingHit = (Flags & WSPelletHit::Flag_BlockingHit) != 0;
+
+	if (Flags & WSPelletHit::Flag_HasActor)
+	{
+		UObject* ActorObject = Actor.Get();
+		bOutSuccess &= Map->SerializeObject(Ar, AActor::StaticClass(), ActorObject);
+		if (Ar.IsLoading())
+		{
+			Actor = Cast<AActor>(ActorObject);
+		}
+	}
+	else if (Ar.IsLoading())
+	{
+		Actor.Reset();
+	}
+
+	bOutSuccess &= SerializePackedVector<10, 24>(Location, Ar);
+
+	if (Flags & WSPelletHit::Flag_HasImpactPoint)
+	{
+		bOutSuccess &= SerializePackedVector<10, 24>(ImpactPoint, Ar);
+	}
+	else if (Ar.IsLoading())
+	{
+		ImpactPoint = Location;
+	}
+
+	uint32 PackedNormal = Ar.IsSaving() ? FWSNetQuantize::EncodeOctahedralNormal(ImpactNormal, WSPelletHit::NormalBitsPerComponent) : 0;
+	Ar.SerializeBits(&PackedNormal, WSPelletHit::NormalBitsPerComponent * 2);
+	if (Ar.IsLoading())
+	{
+		ImpactNormal = FWSNetQuantize::DecodeOctahedralNormal(PackedNormal, WSPelletHit::NormalBitsPerComponent);
+	}
+
+	if (Flags & WSPelletHit::Flag_HasBone)
+	{
+		Ar << BoneIndex;
+	}
+	else if (Ar.IsLoading())
+	{
+		BoneIndex = INDEX_NONE;
+	}
+
+	uint8 Surface = SurfaceType.GetValue();
+	Ar.SerializeBits(&Surface, WSPelletHit::SurfaceTypeBits);
+	SurfaceType = static_cast<EPhysicalSurface>(FMath::Min<uint8>(Surface, SurfaceType_Max - 1));
+
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Shot history
+//----------------------------------------------------------------------------------------------------------------------
+
+void FInstantShotHistory::AddShot(const FInstantHitInfo& Shot)
+{
+	LastSequence++;
+
+	// fill the ring first, then overwrite the oldest shot
+	FInstantShotItem& Item = Items.Num() < Capacity ? Items.AddDefaulted_GetRef() : Items[(LastSequence - 1) % Capacity];
+	Item.Sequence = LastSequence;
+	Item.Shot = Shot;
+
+	MarkItemDirty(Item);
+}
+
+void FInstantShotHistory::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	TArray<const FInstantShotItem*, TInlineAllocator<Capacity>> NewShots;
+	for (const FInstantShotItem& Item : Items)
+	{
+		if (Item.Sequence > LastReplayedSequence)
+		{
+			NewShots.Add(&Item);
+		}
+	}
+
+	if (NewShots.Num() == 0)
+	{
+		return;
+	}
+
+	NewShots.Sort([](const FInstantShotItem& A, const FInstantShotItem& B) { return A.Sequence < B.Sequence; });
+
+	// weapon just became relevant, older shots were fired before the client could see them
+	const int32 FirstShot = LastReplayedSequence == 0 ? NewShots.Num() - 1 : 0;
+	LastReplayedSequence = NewShots.Last()->Sequence;
+
+	if (Owner)
+	{
+		for (int32 ShotIdx = FirstShot; ShotIdx < NewShots.Num(); ShotIdx++)
+		{
+			const FInstantHitInfo& Shot = NewShots[ShotIdx]->Shot;
+			Owner->SimulateInstantHit(Shot.Origin, Shot.RandomSeed, Shot.ReticleSpread);
+		}
+	}
+}
 
 AWSWeapon_Instant::AWSWeapon_Instant()
 {
 	CurrentFiringSpread = 0.0f;
+	ShotCounter = 0;
+	LastBurstEndTime = 0.0;
+	ShotSeedBase = 0;
+}
+
+void AWSWeapon_Instant::OnEnterInventory(UWSWeaponComponent* InWeaponComponent)
+{
+	Super::OnEnterInventory(InWeaponComponent);
+
+	// new owner gets its own seeds
+	if (HasAuthority())
+	{
+		ShotSeedBase = FMath::Rand();
+		MARK_PROPERTY_DIRTY_FROM_NAME(AWSWeapon_Instant, ShotSeedBase, this);
+	}
+}
+
+void AWSWeapon_Instant::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// set on the instance, a pointer set in constructor would be copied from archetype
+	ShotHistory.Owner = this;
+}
+
+void AWSWeapon_Instant::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// have impact effects ready before the first shot
+	if (GetNetMode() != NM_DedicatedServer)
+	{
+		if (UWSImpactEffectSubsystem* ImpactEffects = GetWorld()->GetSubsystem<UWSImpactEffectSubsystem>())
+		{
+			ImpactEffects->PrewarmPool(ImpactTemplate);
+		}
+	}
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -19,150 +247,376 @@ AWSWeapon_Instant::AWSWeapon_Instant()
 
 void AWSWeapon_Instant::FireWeapon()
 {
-	const int32 RandomSeed = FMath::Rand();
-	FRandomStream WeaponRandomStream(RandomSeed);
+	// async trace can finish after the burst, keep the shot it belongs to
+	const int32 ShotIndex = FMath::Max(LocalBurstShots - 1, 0);
+
+	// seed of shot reported to server can't be chosen by client
+	const int32 RandomSeed = IsReportingBurst() ? GetBurstShotSeed(BurstId, ShotIndex) : static_cast<int32>(FWSShotRandom::Hash(FPlatformTime::Cycles(), ++ShotCounter));
 	const float CurrentSpread = GetCurrentSpread();
-	const float ConeHalfAngle = FMath::DegreesToRadians(CurrentSpread * 0.5f);
 
 	const FVector AimDir = GetAdjustedAim();
 	const FVector StartTrace = GetDamageStartLocation(AimDir);
-	const FVector ShootDir = WeaponRandomStream.VRandCone(AimDir, ConeHalfAngle, ConeHalfAngle);
-	const FVector EndTrace = StartTrace + ShootDir * InstantConfig.WeaponRange;
 
-	const FHitResult Impact = WeaponTrace(StartTrace, EndTrace);
-	ProcessInstantHit(Impact, StartTrace, ShootDir, RandomSeed, CurrentSpread);
+	// shot timestamp in server time for lag compensation, shots fired together in one update keep their due times
+	const double ShotTime = GetShotServerTime();
+
+	TraceShot(StartTrace, AimDir, RandomSeed, CurrentSpread,
+		FWSTraceBatchResultDelegate::CreateUObject(this, &AWSWeapon_Instant::OnFireTraceCompleted, StartTrace, AimDir, RandomSeed, CurrentSpread, ShotTime, BurstId, ShotIndex));
 
 	CurrentFiringSpread = FMath::Min(InstantConfig.FiringSpreadMax, CurrentFiringSpread + InstantConfig.FiringSpreadIncrement);
 }
 
-bool AWSWeapon_Instant::ServerNotifyHit_Validate(const FHitResult& Impact, FVector_NetQuantizeNormal ShootDir, int32 RandomSeed, float ReticleSpread)
+void AWSWeapon_Instant::OnFireTraceCompleted(TConstArrayView<FHitResult> Impacts, FVector Origin, FVector AimDir, int32 RandomSeed, float ReticleSpread, double ShotTime,
+	uint8 ShotBurstId, int32 ShotIndex)
+{
+	// weapon could leave inventory while async trace was in flight
+	if (WeaponComponent)
+	{
+		ProcessInstantShot(Impacts, Origin, AimDir, RandomSeed, ReticleSpread, ShotTime, ShotBurstId, ShotIndex);
+	}
+}
+
+void AWSWeapon_Instant::GetShootDirections(const FVector& AimDir, int32 RandomSeed, float ReticleSpread, FInstantShootDirections& OutDirections) const
 {
+	const float ConeHalfAngle = FMath::DegreesToRadians(ReticleSpread * 0.5f);
+	const int32 NumPellets = InstantConfig.GetPelletCount();
+
+	OutDirections.Reset(NumPellets);
+	for (int32 PelletIdx = 0; PelletIdx < NumPellets; PelletIdx++)
+	{
+		OutDirections.Add(FWSShotRandom::VRandCone(AimDir, ConeHalfAngle, static_cast<uint32>(RandomSeed), PelletIdx));
+	}
+}
+
+void AWSWeapon_Instant::TraceShot(const FVector& Origin, const FVector& AimDir, int32 RandomSeed, float ReticleSpread, FWSTraceBatchResultDelegate&& OnComplete)
+{
+	FInstantShootDirections ShootDirs;
+	GetShootDirections(AimDir, RandomSeed, ReticleSpread, ShootDirs);
+
+	TArray<FVector, TInlineAllocator<8>> TraceEnds;
+	for (const FVector& ShootDir : ShootDirs)
+	{
+		TraceEnds.Add(Origin + ShootDir * InstantConfig.WeaponRange);
+	}
+
+	if (UWSTraceSubsystem* TraceSubsystem = GetAsyncTraceSubsystem())
+	{
+		TraceSubsystem->QueueLineTraceBatch(Origin, TraceEnds, COLLISION_WEAPON, GetWeaponTraceParams(), MoveTemp(OnComplete));
+	}
+	else
+	{
+		const FCollisionQueryParams TraceParams = GetWeaponTraceParams();
+
+		TArray<FHitResult, TInlineAllocator<8>> Impacts;
+		for (const FVector& TraceEnd : TraceEnds)
+		{
+			FHitResult& Impact = Impacts.Emplace_GetRef(ForceInit);
+			GetWorld()->LineTraceSingleByChannel(Impact, Origin, TraceEnd, COLLISION_WEAPON, TraceParams);
+		}
+
+		OnComplete.ExecuteIfBound(Impacts);
+	}
+}
+
+UWSTraceSubsystem* AWSWeapon_Instant::GetAsyncTraceSubsystem() const
+{
+	return InstantConfig.bUseAsyncTrace ? GetWorld()->GetSubsystem<UWSTraceSubsystem>() : nullptr;
+}
+
+bool AWSWeapon_Instant::ServerNotifyHits_Validate(const TArray<FInstantShotReport>& Shots)
+{
+	if (Shots.Num() > FInstantShotReport::MaxBatchSize)
+	{
+		return false;
+	}
+
+	// never more hits than pellets in a shot
+	for (const FInstantShotReport& Shot : Shots)
+	{
+		if (Shot.Hits.Num() > InstantConfig.GetPelletCount())
+		{
+			return false;
+		}
+	}
+
 	return true;
 }
 
-void AWSWeapon_Instant::ServerNotifyHit_Implementation(const FHitResult& Impact, FVector_NetQuantizeNormal ShootDir, int32 RandomSeed, float ReticleSpread)
+void AWSWeapon_Instant::ServerNotifyHits_Implementation(const TArray<FInstantShotReport>& Shots)
 {
-	const float WeaponAngleDot = FMath::Abs(FMath::Sin(ReticleSpread * PI / 180.f));
+	for (const FInstantShotReport& Shot : Shots)
+	{
+		ProcessClientShotReport(Shot);
+	}
+}
+
+void AWSWeapon_Instant::ProcessClientShotReport(const FInstantShotReport& Shot)
+{
+	const FVector Origin = Shot.Origin;
+	const FVector AimDir = Shot.AimDir;
+	const float ReticleSpread = Shot.ReticleSpread;
 
-	// if we have an instigator, calculate dot between the view and the shot
-	if (GetInstigator() && (Impact.GetActor() || Impact.bBlockingHit))
+	// no more shot data than shots the server charged ammo for
+	if (!ConsumeBurstShotReport(Shot.BurstId, Shot.ShotIndex))
 	{
-		const FVector Origin = GetMuzzleLocation();
-		const FVector ViewDir = (Impact.Location - Origin).GetSafeNormal();
+		return;
+	}
+
+	if (!IsClientShotValid(Origin, AimDir, ReticleSpread, Shot.ShotTime, Shot.ShotIndex))
+	{
+		return;
+	}
 
-		// is the angle between the hit and the view within allowed limits (limit + weapon max angle)
-		const float ViewDotHitDir = FVector::DotProduct(GetInstigator()->GetViewRotation().Vector(), ViewDir);
-		if (ViewDotHitDir > InstantConfig.AllowedViewDotHitDir - WeaponAngleDot)
+	// the burst matches, so the seed is derived from the same values the client used
+	const int32 RandomSeed = GetBurstShotSeed(Shot.BurstId, Shot.ShotIndex);
+
+	// rebuild the whole spread from the seed
+	FInstantShootDirections ShootDirs;
+	GetShootDirections(AimDir, RandomSeed, ReticleSpread, ShootDirs);
+
+	uint32 ProcessedPellets = 0;
+	int32 NumConfirmed = 0;
+	for (const FInstantPelletHit& Hit : Shot.Hits)
+	{
+		if (!ShootDirs.IsValidIndex(Hit.PelletIndex))
 		{
-			if (CurrentState != EWeaponState::EWS_Idle)
-			{
-				if (Impact.GetActor() == nullptr)
-				{
-					if (Impact.bBlockingHit)
-					{
-						ProcessInstantHit_Confirmed(Impact, Origin, ShootDir, RandomSeed, ReticleSpread);
-					}
-				}
-				// assume it told the truth about static things because the don't move and the hit 
-				// usually doesn't have significant gameplay implications
-				else if (Impact.GetActor()->IsRootComponentStatic() || Impact.GetActor()->IsRootComponentStationary())
-				{
-					ProcessInstantHit_Confirmed(Impact, Origin, ShootDir, RandomSeed, ReticleSpread);
-				}
-				else
-				{
-					// Get the component bounding box
-					const FBox HitBox = Impact.GetActor()->GetComponentsBoundingBox();
-
-					// calculate the box extent, and increase by a leeway
-					FVector BoxExtent = 0.5 * (HitBox.Max - HitBox.Min);
-					BoxExtent *= InstantConfig.ClientSideHitLeeway;
-
-					// avoid precision errors with really thin objects
-					BoxExtent.X = FMath::Max(20.0f, BoxExtent.X);
-					BoxExtent.Y = FMath::Max(20.0f, BoxExtent.Y);
-					BoxExtent.Z = FMath::Max(20.0f, BoxExtent.Z);
-
-					// Get the box center
-					const FVector BoxCenter = (HitBox.Min + HitBox.Max) * 0.5;
-
-					// if we are within client tolerance
-					if (FMath::Abs(Impact.Location.Z - BoxCenter.Z) < BoxExtent.Z &&
-						FMath::Abs(Impact.Location.X - BoxCenter.X) < BoxExtent.X &&
-						FMath::Abs(Impact.Location.Y - BoxCenter.Y) < BoxExtent.Y)
-					{
-						ProcessInstantHit_Confirmed(Impact, Origin, ShootDir, RandomSeed, ReticleSpread);
-					}
-					else
-					{
-						UE_LOG(LogWeaponSystem, Log, TEXT("%s Rejected client side hit of %s (outside bounding box tolerance)"), *GetNameSafe(this), *GetNameSafe(Impact.GetActor()));
-					}
-				}
-			}
+			continue;
 		}
-		else if (ViewDotHitDir <= InstantConfig.AllowedViewDotHitDir)
+
+		// each pellet can be confirmed only once
+		const uint32 PelletBit = 1u << Hit.PelletIndex;
+		if ((ProcessedPellets & PelletBit) != 0)
 		{
-			UE_LOG(LogWeaponSystem, Log, TEXT("%s Rejected client side hit of %s (facing too far from the hit direction)"), *GetNameSafe(this), *GetNameSafe(Impact.GetActor()));
+			continue;
 		}
-		else
+
+		ProcessedPellets |= PelletBit;
+
+		const FVector& ShootDir = ShootDirs[Hit.PelletIndex];
+		FHitResult Impact;
+		Hit.ToHitResult(Origin, Origin + ShootDir * InstantConfig.WeaponRange, Impact);
+
+		if (IsClientHitValid(Impact, Origin, ShootDir, Shot.ShotTime))
+		{
+			ProcessInstantHit_Confirmed(Impact, Origin, ShootDir, Hit.SurfaceType);
+			NumConfirmed++;
+		}
+	}
+
+	// confirmed hits or a miss
+	if (NumConfirmed > 0 || Shot.Hits.Num() == 0)
+	{
+		// play FX on remote clients
+		ReplicateShot(Origin, RandomSeed, ReticleSpread);
+
+		// play trails of missed pellets locally
+		if (GetNetMode() != NM_DedicatedServer)
 		{
-			UE_LOG(LogWeaponSystem, Log, TEXT("%s Rejected client side hit of %s"), *GetNameSafe(this), *GetNameSafe(Impact.GetActor()));
+			for (int32 PelletIdx = 0; PelletIdx < ShootDirs.Num(); PelletIdx++)
+			{
+				if ((ProcessedPellets & (1u << PelletIdx)) == 0)
+				{
+					SpawnTrailEffect(Origin + ShootDirs[PelletIdx] * InstantConfig.WeaponRange);
+				}
+			}
 		}
 	}
 }
 
-bool AWSWeapon_Instant::ServerNotifyMiss_Validate(FVector_NetQuantizeNormal ShootDir, int32 RandomSeed, float ReticleSpread)
+bool AWSWeapon_Instant::IsClientShotValid(const FVector& Origin, const FVector& AimDir, float ReticleSpread, double ShotTime, int32 ShotIndex) const
 {
+	const APawn* MyPawn = GetInstigator();
+	if (MyPawn == nullptr)
+	{
+		return false;
+	}
+
+	// async trace of the last shot finishes a frame late and its hits arrive after the stop,
+	// accept shots fired before the stop for one refire interval
+	if (CurrentState == EWeaponState::EWS_Idle)
+	{
+		const double ServerTime = GetServerWorldTime();
+		const float LateShotWindow = FMath::Max(WeaponConfig.TimeBetweenShots, BurstAckInterval);
+		if (ShotTime > LastBurstEndTime + BurstScheduleTolerance || ServerTime - LastBurstEndTime > LateShotWindow)
+		{
+			UE_LOG(LogWeaponSystem, Log, TEXT("%s Rejected client shot (weapon is not firing)"), *GetNameSafe(this));
+			return false;
+		}
+	}
+
+	// spread has to match the shot's place in the burst, targeting can change before the server knows it
+	const float ShotSpread = GetBurstShotSpread(ShotIndex);
+	const float MinSpread = ShotSpread * FMath::Min(1.0f, InstantConfig.TargetingSpreadMod) - InstantConfig.AllowedSpreadOffset;
+	const float MaxSpread = ShotSpread * FMath::Max(1.0f, InstantConfig.TargetingSpreadMod) + InstantConfig.AllowedSpreadOffset;
+	if (ReticleSpread < MinSpread || ReticleSpread > MaxSpread)
+	{
+		UE_LOG(LogWeaponSystem, Log, TEXT("%s Rejected client shot (spread %.2f is outside %.2f - %.2f)"), *GetNameSafe(this), ReticleSpread, MinSpread, MaxSpread);
+		return false;
+	}
+
+	// is the angle between the aim and the view within allowed limits
+	const float ViewDotAimDir = FVector::DotProduct(MyPawn->GetViewRotation().Vector(), AimDir);
+	if (ViewDotAimDir <= InstantConfig.AllowedViewDotHitDir)
+	{
+		UE_LOG(LogWeaponSystem, Log, TEXT("%s Rejected client shot (facing too far from the aim direction)"), *GetNameSafe(this));
+		return false;
+	}
+
+	// shot has to start near the weapon
+	if (FVector::DistSquared(Origin, GetDamageStartLocation(AimDir)) > FMath::Square(InstantConfig.AllowedOriginOffset))
+	{
+		UE_LOG(LogWeaponSystem, Log, TEXT("%s Rejected client shot (origin too far from the weapon)"), *GetNameSafe(this));
+		return false;
+	}
+
 	return true;
 }
 
-void AWSWeapon_Instant::ServerNotifyMiss_Implementation(FVector_NetQuantizeNormal ShootDir, int32 RandomSeed, float ReticleSpread)
+bool AWSWeapon_Instant::IsClientHitValid(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, double ShotTime) const
 {
-	const FVector Origin = GetMuzzleLocation();
+	if (!Impact.bBlockingHit)
+	{
+		return false;
+	}
 
-	// play FX on remote clients
-	HitNotify.Origin = Origin;
-	HitNotify.RandomSeed = RandomSeed;
-	HitNotify.ReticleSpread = ReticleSpread;
+	// impact has to lie on the pellet ray, no trace needed
+	const FVector ToImpact = Impact.Location - Origin;
+	const float DistAlongRay = FVector::DotProduct(ToImpact, ShootDir);
+	const float DistFromRaySq = (ToImpact - ShootDir * DistAlongRay).SizeSquared();
+	if (DistAlongRay < 0.0f || DistAlongRay > InstantConfig.WeaponRange + InstantConfig.AllowedHitOffset || DistFromRaySq > FMath::Square(InstantConfig.AllowedHitOffset))
+	{
+		UE_LOG(LogWeaponSystem, Log, TEXT("%s Rejected client side hit of %s (not on the shot ray)"), *GetNameSafe(this), *GetNameSafe(Impact.GetActor()));
+		return false;
+	}
 
-	// play FX locally
-	if (GetNetMode() != NM_DedicatedServer)
+	if (Impact.GetActor() == nullptr)
 	{
-		const FVector EndTrace = Origin + ShootDir * InstantConfig.WeaponRange;
-		SpawnTrailEffect(EndTrace);
+		return true;
+	}
+
+	// assume it told the truth about static things because the don't move and the hit
+	// usually doesn't have significant gameplay implications
+	if (Impact.GetActor()->IsRootComponentStatic() || Impact.GetActor()->IsRootComponentStationary())
+	{
+		return true;
 	}
+
+	return IsClientHitOnActorValid(Impact, Origin, ShotTime);
 }
 
-void AWSWeapon_Instant::ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 RandomSeed, float ReticleSpread)
+bool AWSWeapon_Instant::IsClientHitOnActorValid(const FHitResult& Impact, const FVector& Origin, double ShotTime) const
 {
-	if (WeaponComponent && WeaponComponent->IsLocallyControlled() && GetNetMode() == NM_Client)
+	// rewind the hitbox to the moment the client fired
+	const UWSLagCompensationSubsystem* LagCompensation = InstantConfig.bUseLagCompensation ? GetWorld()->GetSubsystem<UWSLagCompensationSubsystem>() : nullptr;
+	if (LagCompensation)
 	{
-		// if we're a client and we've hit something that is being controlled by the server
-		if (Impact.GetActor() && Impact.GetActor()->GetRemoteRole() == ROLE_Authority)
+		const double RewindTime = LagCompensation->GetShotRewindTime(GetInstigator(), ShotTime);
+		const EWSRewindHitResult RewindResult = LagCompensation->ValidateHit(Impact.GetActor(), RewindTime, Origin, Impact.Location, InstantConfig.LagCompensationTolerance);
+		if (RewindResult == EWSRewindHitResult::Hit)
 		{
-			// notify the server of the hit
-			ServerNotifyHit(Impact, ShootDir, RandomSeed, ReticleSpread);
+			return true;
 		}
-		else if (Impact.GetActor() == nullptr)
+
+		if (RewindResult == EWSRewindHitResult::Miss)
 		{
-			if (Impact.bBlockingHit)
+			UE_LOG(LogWeaponSystem, Log, TEXT("%s Rejected client side hit of %s (outside lag compensated hitbox)"), *GetNameSafe(this), *GetNameSafe(Impact.GetActor()));
+			return false;
+		}
+	}
+
+	// Get the component bounding box
+	const FBox HitBox = Impact.GetActor()->GetComponentsBoundingBox();
+
+	// calculate the box extent, and increase by a leeway
+	FVector BoxExtent = 0.5 * (HitBox.Max - HitBox.Min);
+	BoxExtent *= InstantConfig.ClientSideHitLeeway;
+
+	// avoid precision errors with really thin objects
+	BoxExtent.X = FMath::Max(20.0f, BoxExtent.X);
+	BoxExtent.Y = FMath::Max(20.0f, BoxExtent.Y);
+	BoxExtent.Z = FMath::Max(20.0f, BoxExtent.Z);
+
+	// Get the box center
+	const FVector BoxCenter = (HitBox.Min + HitBox.Max) * 0.5;
+
+	// if we are within client tolerance
+	if (FMath::Abs(Impact.Location.Z - BoxCenter.Z) < BoxExtent.Z &&
+		FMath::Abs(Impact.Location.X - BoxCenter.X) < BoxExtent.X &&
+		FMath::Abs(Impact.Location.Y - BoxCenter.Y) < BoxExtent.Y)
+	{
+		return true;
+	}
+
+	UE_LOG(LogWeaponSystem, Log, TEXT("%s Rejected client side hit of %s (outside bounding box tolerance)"), *GetNameSafe(this), *GetNameSafe(Impact.GetActor()));
+	return false;
+}
+
+void AWSWeapon_Instant::FlushBurstBatch()
+{
+	if (PendingShotReports.Num() > 0)
+	{
+		// notify the server of the hits
+		ServerNotifyHits(PendingShotReports);
+		PendingShotReports.Reset();
+	}
+}
+
+void AWSWeapon_Instant::ProcessInstantShot(TConstArrayView<FHitResult> Impacts, const FVector& Origin, const FVector& AimDir, int32 RandomSeed, float ReticleSpread, double ShotTime,
+	uint8 ShotBurstId, int32 ShotIndex)
+{
+	if (WeaponComponent && WeaponComponent->IsLocallyControlled() && GetNetMode() == NM_Client)
+	{
+		// pack all pellet hits of the shot into one report
+		FInstantShotReport Report;
+		bool bAnyBlockingHit = false;
+
+		for (int32 PelletIdx = 0; PelletIdx < Impacts.Num(); PelletIdx++)
+		{
+			const FHitResult& Impact = Impacts[PelletIdx];
+			bAnyBlockingHit |= Impact.bBlockingHit;
+
+			// if we're a client and we've hit something that is being controlled by the server
+			if ((Impact.GetActor() && Impact.GetActor()->GetRemoteRole() == ROLE_Authority) ||
+				(Impact.GetActor() == nullptr && Impact.bBlockingHit))
 			{
-				// notify the server of the hit
-				ServerNotifyHit(Impact, ShootDir, RandomSeed, ReticleSpread);
+				Report.Hits.Emplace(static_cast<uint8>(PelletIdx), Impact);
 			}
-			else
+		}
+
+		// misses are reported too so the server plays shot FX, shot with only unreported hits needs nothing
+		if (Report.Hits.Num() > 0 || !bAnyBlockingHit)
+		{
+			Report.Origin = Origin;
+			Report.AimDir = AimDir;
+			Report.ReticleSpread = ReticleSpread;
+			Report.ShotTime = ShotTime;
+			Report.BurstId = ShotBurstId;
+			Report.ShotIndex = static_cast<uint16>(FMath::Min(ShotIndex, static_cast<int32>(MAX_uint16)));
+			PendingShotReports.Add(MoveTemp(Report));
+
+			// shots are sent with the next burst acknowledgement, async trace of the last shot can finish after the burst
+			// and is sent right away
+			if (!IsReportingBurst() || PendingShotReports.Num() >= FInstantShotReport::MaxBatchSize)
 			{
-				// notify server of the miss
-				ServerNotifyMiss(ShootDir, RandomSeed, ReticleSpread);
+				FlushBurstBatch();
 			}
 		}
 	}
 
-	// process a confirmed hit
-	ProcessInstantHit_Confirmed(Impact, Origin, ShootDir, RandomSeed, ReticleSpread);
+	// process confirmed hits
+	for (const FHitResult& Impact : Impacts)
+	{
+		ProcessInstantHit_Confirmed(Impact, Origin, (Impact.TraceEnd - Impact.TraceStart).GetSafeNormal());
+	}
+
+	// play FX on remote clients
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		ReplicateShot(Origin, RandomSeed, ReticleSpread);
+	}
 }
 
-void AWSWeapon_Instant::ProcessInstantHit_Confirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 RandomSeed, float ReticleSpread)
+void AWSWeapon_Instant::ProcessInstantHit_Confirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, EPhysicalSurface SurfaceType)
 {
 	// handle damage
 	if (ShouldDealDamage(Impact.GetActor()))
@@ -170,14 +624,6 @@ void AWSWeapon_Instant::ProcessInstantHit_Confirmed(const FHitResult& Impact, co
 		DealDamage(Impact, ShootDir);
 	}
 
-	// play FX on remote clients
-	if (GetLocalRole() == ROLE_Authority)
-	{
-		HitNotify.Origin = Origin;
-		HitNotify.RandomSeed = RandomSeed;
-		HitNotify.ReticleSpread = ReticleSpread;
-	}
-
 	// play FX locally
 	if (GetNetMode() != NM_DedicatedServer)
 	{
@@ -185,10 +631,20 @@ void AWSWeapon_Instant::ProcessInstantHit_Confirmed(const FHitResult& Impact, co
 		const FVector EndPoint = Impact.GetActor() ? Impact.ImpactPoint : EndTrace;
 
 		SpawnTrailEffect(EndPoint);
-		SpawnImpactEffects(Impact);
+		SpawnImpactEffects(Impact, SurfaceType);
 	}
 }
 
+void AWSWeapon_Instant::ReplicateShot(const FVector& Origin, int32 RandomSeed, float ReticleSpread)
+{
+	FInstantHitInfo Shot;
+	Shot.Origin = Origin;
+	Shot.RandomSeed = RandomSeed;
+	Shot.ReticleSpread = ReticleSpread;
+
+	ShotHistory.AddShot(Shot);
+}
+
 bool AWSWeapon_Instant::ShouldDealDamage(AActor* InActor) const
 {
 	// if we're an actor on the server, or the actor's role is authoritative, we should register damage
@@ -221,6 +677,11 @@ void AWSWeapon_Instant::OnBurstFinished()
 	Super::OnBurstFinished();
 
 	CurrentFiringSpread = 0.0f;
+
+	if (HasAuthority())
+	{
+		LastBurstEndTime = GetServerWorldTime();
+	}
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -238,38 +699,49 @@ float AWSWeapon_Instant::GetCurrentSpread() const
 	return FinalSpread;
 }
 
+float AWSWeapon_Instant::GetBurstShotSpread(int32 ShotIndex) const
+{
+	// firing spread grows by one increment after every shot and is reset with the burst
+	return InstantConfig.WeaponSpread + FMath::Min(InstantConfig.FiringSpreadMax, ShotIndex * InstantConfig.FiringSpreadIncrement);
+}
+
+int32 AWSWeapon_Instant::GetBurstShotSeed(uint8 InBurstId, int32 ShotIndex) const
+{
+	return MakeShotSeed(ShotSeedBase, InBurstId, ShotIndex);
+}
+
+int32 AWSWeapon_Instant::MakeShotSeed(int32 SeedBase, uint8 InBurstId, int32 ShotIndex)
+{
+	return static_cast<int32>(FWSShotRandom::Hash(FWSShotRandom::Hash(static_cast<uint32>(SeedBase), InBurstId), static_cast<uint32>(ShotIndex)));
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 // Replication & effects
 //----------------------------------------------------------------------------------------------------------------------
 
-void AWSWeapon_Instant::OnRep_HitNotify()
+void AWSWeapon_Instant::SimulateInstantHit(const FVector& ShotOrigin, int32 RandomSeed, float ReticleSpread)
 {
-	SimulateInstantHit(HitNotify.Origin, HitNotify.RandomSeed, HitNotify.ReticleSpread);
+	TraceShot(ShotOrigin, GetAdjustedAim(), RandomSeed, ReticleSpread,
+		FWSTraceBatchResultDelegate::CreateUObject(this, &AWSWeapon_Instant::OnSimulateTraceCompleted));
 }
 
-void AWSWeapon_Instant::SimulateInstantHit(const FVector& ShotOrigin, int32 RandomSeed, float ReticleSpread)
+void AWSWeapon_Instant::OnSimulateTraceCompleted(TConstArrayView<FHitResult> Impacts)
 {
-	const FRandomStream WeaponRandomStream(RandomSeed);
-	const float ConeHalfAngle = FMath::DegreesToRadians(ReticleSpread * 0.5f);
-
-	const FVector StartTrace = ShotOrigin;
-	const FVector AimDir = GetAdjustedAim();
-	const FVector ShootDir = WeaponRandomStream.VRandCone(AimDir, ConeHalfAngle, ConeHalfAngle);
-	const FVector EndTrace = StartTrace + ShootDir * InstantConfig.WeaponRange;
-
-	const FHitResult Impact = WeaponTrace(StartTrace, EndTrace);
-	if (Impact.bBlockingHit)
+	for (const FHitResult& Impact : Impacts)
 	{
-		SpawnImpactEffects(Impact);
-		SpawnTrailEffect(Impact.ImpactPoint);
-	}
-	else
-	{
-		SpawnTrailEffect(EndTrace);
+		if (Impact.bBlockingHit)
+		{
+			SpawnImpactEffects(Impact);
+			SpawnTrailEffect(Impact.ImpactPoint);
+		}
+		else
+		{
+			SpawnTrailEffect(Impact.TraceEnd);
+		}
 	}
 }
 
-void AWSWeapon_Instant::SpawnImpactEffects(const FHitResult& Impact)
+void AWSWeapon_Instant::SpawnImpactEffects(const FHitResult& Impact, EPhysicalSurface SurfaceType)
 {
 	if (ImpactTemplate && Impact.bBlockingHit)
 	{
@@ -285,26 +757,21 @@ void AWSWeapon_Instant::SpawnImpactEffects(const FHitResult& Impact)
 		}
 		
 		FTransform const SpawnTransform(Impact.ImpactNormal.Rotation(), Impact.ImpactPoint);
-		AWSImpactEffect* EffectActor = GetWorld()->SpawnActorDeferred<AWSImpactEffect>(ImpactTemplate, SpawnTransform);
-		if (EffectActor)
+		if (UWSImpactEffectSubsystem* ImpactEffects = GetWorld()->GetSubsystem<UWSImpactEffectSubsystem>())
 		{
-			EffectActor->SurfaceHit = UseImpact;
-			UGameplayStatics::FinishSpawningActor(EffectActor, SpawnTransform);
+			ImpactEffects->SpawnImpactEffect(ImpactTemplate, SpawnTransform, UseImpact, SurfaceType);
 		}
 	}
 }
 
 void AWSWeapon_Instant::SpawnTrailEffect(const FVector& EndPoint)
 {
-	if (TrailFX)
+	UWSTracerSubsystem* Tracers = GetWorld()->GetSubsystem<UWSTracerSubsystem>();
+	if (TrailFX && Tracers)
 	{
-		const FVector Origin = GetMuzzleLocation();
-
-		UParticleSystemComponent* TrailPSC = UGameplayStatics::SpawnEmitterAtLocation(this, TrailFX, Origin);
-		if (TrailPSC)
-		{
-			TrailPSC->SetVectorParameter(TrailTargetParam, EndPoint);
-		}
+		// own tracers are never culled
+		const bool bLocallyControlled = WeaponComponent && WeaponComponent->IsLocallyControlled();
+		Tracers->SpawnTracer(TrailFX, TrailTargetParam, GetMuzzleLocation(), EndPoint, bLocallyControlled);
 	}
 }
 
@@ -312,5 +779,12 @@ void AWSWeapon_Instant::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Ou
 {
 	Super::GetLifetimeReplicatedProps( OutLifetimeProps );
 
-	DOREPLIFETIME_CONDITION(AWSWeapon_Instant, HitNotify, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(AWSWeapon_Instant, ShotHistory, COND_SkipOwner);
+
+	// push model, changes only with owner
+	FDoRepLifetimeParams OwnerOnlyParams;
+	OwnerOnlyParams.bIsPushBased = true;
+	OwnerOnlyParams.Condition = COND_OwnerOnly;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(AWSWeapon_Instant, ShotSeedBase, OwnerOnlyParams);
 }
\ No newline at end of file
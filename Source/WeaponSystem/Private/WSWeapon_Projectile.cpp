@@ -5,13 +5,98 @@
 
 
 #include "WSProjectile.h"
+#include "Subsystems/WSProjectilePoolSubsystem.h"
+#include "Subsystems/WSProjectileSimSubsystem.h"
+#include "Components/WSWeaponComponent.h"
+#include "GameFramework/PlayerState.h"
 #include "Kismet/GameplayStatics.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Engine/NetSerialization.h"
+#include "WSTypes.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+// Explosion info
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace WSExplosionInfo
+{
+	constexpr int32 NormalBitsPerComponent = 12;
+	constexpr int32 SurfaceTypeBits = 6;
+}
+
+static_assert(SurfaceType_Max <= (1 << WSExplosionInfo::SurfaceTypeBits), "Surface type doesn't fit serialized bits");
+
+FProjectileExplosionInfo::FProjectileExplosionInfo(const FHitResult& Impact):
+	bExploded(true),
+	ImpactPoint(Impact.ImpactPoint),
+	ImpactNormal(Impact.ImpactNormal),
+	SurfaceType(UPhysicalMaterial::DetermineSurfaceType(Impact.PhysMaterial.Get()))
+{
+}
+
+void FProjectileExplosionInfo::ToHitResult(FHitResult& OutImpact) const
+{
+	OutImpact = FHitResult(ImpactPoint + ImpactNormal, ImpactPoint - ImpactNormal);
+	OutImpact.bBlockingHit = true;
+	OutImpact.Location = ImpactPoint;
+	OutImpact.ImpactPoint = ImpactPoint;
+	OutImpact.Normal = ImpactNormal;
+	OutImpact.ImpactNormal = ImpactNormal;
+}
+
+bool FProjectileExplosionInfo::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 bExplodedBit = bExploded ? 1 : 0;
+	Ar.SerializeBits(&bExplodedBit, 1);
+	bExploded = bExplodedBit != 0;
+
+	bOutSuccess = true;
+
+	// projectile was reused, nothing else to send
+	if (!bExploded)
+	{
+		return true;
+	}
+
+	bOutSuccess &= SerializePackedVector<10, 24>(ImpactPoint, Ar);
+
+	uint32 PackedNormal = Ar.IsSaving() ? FWSNetQuantize::EncodeOctahedralNormal(ImpactNormal, WSExplosionInfo::NormalBitsPerComponent) : 0;
+	Ar.SerializeBits(&PackedNormal, WSExplosionInfo::NormalBitsPerComponent * 2);
+	if (Ar.IsLoading())
+	{
+		ImpactNormal = FWSNetQuantize::DecodeOctahedralNormal(PackedNormal, WSExplosionInfo::NormalBitsPerComponent);
+	}
+
+	uint8 Surface = SurfaceType.GetValue();
+	Ar.SerializeBits(&Surface, WSExplosionInfo::SurfaceTypeBits);
+	SurfaceType = static_cast<EPhysicalSurface>(FMath::Min<uint8>(Surface, SurfaceType_Max - 1));
+
+	return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Weapon
+//----------------------------------------------------------------------------------------------------------------------
 
 AWSWeapon_Projectile::AWSWeapon_Projectile()
 {
 	
 }
 
+void AWSWeapon_Projectile::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// have projectiles ready before the first shot
+	if (HasAuthority() && !ProjectileConfig.UsesProjectileSim())
+	{
+		if (UWSProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UWSProjectilePoolSubsystem>())
+		{
+			ProjectilePool->PrewarmPool(ProjectileConfig.ProjectileClass);
+		}
+	}
+}
+
 void AWSWeapon_Projectile::ApplyWeaponConfig(FProjectileWeaponData& Data)
 {
 	Data = ProjectileConfig;
@@ -67,10 +152,17 @@ void AWSWeapon_Projectile::FireWeapon()
 		}
 	}
 
-	ServerFireProjectile(Origin, ShootDir);
+	if (ProjectileConfig.bPredictProjectile && !ProjectileConfig.UsesProjectileSim() && !HasAuthority())
+	{
+		SpawnPredictedProjectile(Origin, ShootDir);
+	}
+
+	// server runs the RPC outside of fire update, keep sub-frame spacing of shots fired together
+	const int32 ShotTimeOffsetMs = FMath::RoundToInt(GetShotTimeOffset() * 1000.0f);
+	ServerFireProjectile(Origin, ShootDir, static_cast<uint8>(FMath::Clamp(ShotTimeOffsetMs, 0, static_cast<int32>(MAX_uint8))));
 }
 
-void AWSWeapon_Projectile::ServerFireProjectile_Implementation(FVector Origin, FVector_NetQuantizeNormal ShootDir)
+void AWSWeapon_Projectile::SpawnPredictedProjectile(const FVector& Origin, const FVector& ShootDir)
 {
 	const FTransform SpawnTransform(ShootDir.Rotation(), Origin);
 	AWSProjectile* Projectile = Cast<AWSProjectile>(UGameplayStatics::BeginDeferredActorSpawnFromClass(this, ProjectileConfig.ProjectileClass, SpawnTransform));
@@ -78,13 +170,96 @@ void AWSWeapon_Projectile::ServerFireProjectile_Implementation(FVector Origin, F
 	{
 		Projectile->SetInstigator(GetInstigator());
 		Projectile->SetOwner(this);
+		Projectile->InitPredictedProjectile();
 		Projectile->InitVelocity(ShootDir);
 
 		UGameplayStatics::FinishSpawningActor(Projectile, SpawnTransform);
+		Projectile->FastForward(GetShotTimeOffset());
+		PredictedProjectiles.Add(Projectile);
+	}
+}
+
+AWSProjectile* AWSWeapon_Projectile::TakePredictedProjectile()
+{
+	while (PredictedProjectiles.Num() > 0)
+	{
+		AWSProjectile* Projectile = PredictedProjectiles[0].Get();
+		PredictedProjectiles.RemoveAt(0, 1, false);
+		if (Projectile)
+		{
+			return Projectile;
+		}
+	}
+
+	return nullptr;
+}
+
+float AWSWeapon_Projectile::GetPredictionTime() const
+{
+	// listen server host has nothing to catch up with
+	if (WeaponComponent == nullptr || WeaponComponent->IsLocallyControlled() || !ProjectileConfig.bPredictProjectile)
+	{
+		return 0.0f;
+	}
+
+	const APawn* MyPawn = GetInstigator();
+	const APlayerState* PlayerState = MyPawn ? MyPawn->GetPlayerState() : nullptr;
+	if (PlayerState == nullptr)
+	{
+		return 0.0f;
+	}
+
+	return FMath::Min(PlayerState->GetPingInMilliseconds() * 0.0005f, MaxPredictionTime);
+}
+
+float AWSWeapon_Projectile::GetClientShotTimeOffset(uint8 ShotTimeOffsetMs) const
+{
+	// listen server host calls the RPC directly from its fire update
+	if (WeaponComponent && WeaponComponent->IsLocallyControlled())
+	{
+		return GetShotTimeOffset();
+	}
+
+	// only shots of one fire update can be due in the past
+	const float MaxOffset = WeaponConfig.TimeBetweenShots * FMath::Max(MaxShotsPerFireUpdate - 1, 0);
+	return FMath::Min(ShotTimeOffsetMs * 0.001f, MaxOffset);
+}
+
+void AWSWeapon_Projectile::ServerFireProjectile_Implementation(FVector Origin, FVector_NetQuantizeNormal ShootDir, uint8 ShotTimeOffsetMs)
+{
+	const float ShotTimeOffset = GetClientShotTimeOffset(ShotTimeOffsetMs);
+
+	if (ProjectileConfig.UsesProjectileSim())
+	{
+		UWSProjectileSimSubsystem* ProjectileSim = GetWorld()->GetSubsystem<UWSProjectileSimSubsystem>();
+		if (ProjectileSim == nullptr)
+		{
+			return;
+		}
+
+		FProjectileSpawnRecord SpawnRecord;
+		SpawnRecord.Origin = Origin;
+		SpawnRecord.ShootDir = ShootDir;
+		SpawnRecord.ServerTime = GetServerWorldTime() - GetPredictionTime() - ShotTimeOffset;
+
+		// clients simulate the projectile from spawn parameters instead of receiving its movement
+		ProjectileSim->SpawnProjectile(this, SpawnRecord);
+		return;
+	}
+
+	const FTransform SpawnTransform(ShootDir.Rotation(), Origin);
+	if (UWSProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UWSProjectilePoolSubsystem>())
+	{
+		AWSProjectile* Projectile = ProjectilePool->SpawnProjectile(ProjectileConfig.ProjectileClass, SpawnTransform, this, GetInstigator(), ShootDir);
+		if (Projectile)
+		{
+			// catch up with projectile predicted by the shooter and with the shot due time
+			Projectile->FastForward(GetPredictionTime() + ShotTimeOffset);
+		}
 	}
 }
 
-bool AWSWeapon_Projectile::ServerFireProjectile_Validate(FVector Origin, FVector_NetQuantizeNormal ShootDir)
+bool AWSWeapon_Projectile::ServerFireProjectile_Validate(FVector Origin, FVector_NetQuantizeNormal ShootDir, uint8 ShotTimeOffsetMs)
 {
 	return true;
 }
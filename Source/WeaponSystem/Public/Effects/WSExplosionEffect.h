@@ -41,11 +41,30 @@ public:
 	UPROPERTY(BlueprintReadOnly, Category=Surface)
 	FHitResult SurfaceHit;
 
+	/** surface type override, used when hit was received without physical material */
+	UPROPERTY(BlueprintReadOnly, Category=Surface)
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
 	AWSExplosionEffect();
 
-	/** update fading light */
+	/** update fading light, used only when explosion light manager is not available */
 	virtual void Tick(float DeltaSeconds) override;
 
+	/**
+	* play explosion, native classes and blueprints without additions are played from class defaults without spawning an actor
+	*
+	* @param World				World to play explosion in
+	* @param EffectClass		Explosion class
+	* @param SpawnTransform		Explosion transform
+	* @param SurfaceHit			Surface hit by explosion
+	* @param SurfaceType		Surface type override for hits without physical material
+	*/
+	static void PlayExplosion(UWorld* World, TSubclassOf<AWSExplosionEffect> EffectClass, const FTransform& SpawnTransform, const FHitResult& SurfaceHit,
+		EPhysicalSurface SurfaceType = SurfaceType_Default);
+
+	/** can class be played from its defaults, blueprints with components, timelines or any script need a live actor */
+	static bool CanPlayWithoutActor(TSubclassOf<AWSExplosionEffect> EffectClass);
+
 	/** Returns ExplosionLight subobject **/
 	FORCEINLINE UPointLightComponent* GetExplosionLight() const { return ExplosionLight; }
 
@@ -54,6 +73,13 @@ protected:
 	/** spawn explosion */
 	virtual void BeginPlay() override;
 
+	/**
+	* spawn FX, sound, decal and light
+	*
+	* @return false if light must be faded by the effect itself
+	*/
+	static bool SpawnEffects(UWorld* World, const AWSExplosionEffect* Settings, const FTransform& SpawnTransform, const FHitResult& SurfaceHit);
+
 private:
 
 	/** explosion light */
@@ -62,4 +88,7 @@ private:
 
 	/** Point light component name */
 	FName ExplosionLightComponentName;
+
+	/** light intensity at spawn */
+	float ExplosionLightIntensity;
 };
@@ -8,6 +8,8 @@
 #include "WSImpactEffect.generated.h"
 
 class USoundCue;
+class UParticleSystemComponent;
+class UWSSurfaceEffectData;
 
 /**
  * Spawnable effect for weapon hit impact - NOT replicated to clients
@@ -19,6 +21,10 @@ class WEAPONSYSTEM_API AWSImpactEffect : public AActor
 	GENERATED_BODY()
 
 public:
+
+	/** shared surface effects table, per surface fields below are used only when it's not set */
+	UPROPERTY(EditDefaultsOnly, Category=Defaults)
+	TObjectPtr<UWSSurfaceEffectData> SurfaceEffects;
 	
 	/** default impact FX used when material specific override doesn't exist */
 	UPROPERTY(EditDefaultsOnly, Category=Defaults)
@@ -100,11 +106,24 @@ public:
 	UPROPERTY(BlueprintReadOnly, Category=Surface)
 	FHitResult SurfaceHit;
 
+	/** surface type override, used when hit was received without physical material */
+	UPROPERTY(BlueprintReadOnly, Category=Surface)
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
 	AWSImpactEffect();
 
-	/** spawn effect */
+	/** spawn effect, pooled effects are activated by the pool */
 	virtual void PostInitializeComponents() override;
 
+	/** play effect at current transform for SurfaceHit */
+	void ActivateEffect();
+
+	/** stop spawned components and clear surface data, effect is ready for reuse */
+	void ResetEffect();
+
+	/** is effect owned by the impact effect pool */
+	bool IsPooled() const { return bPooled; }
+
 protected:
 
 	/** get FX for material type */
@@ -113,4 +132,17 @@ protected:
 	/** get sound for material type */
 	USoundCue* GetImpactSound(TEnumAsByte<EPhysicalSurface> SurfaceType) const;
 
+	/** get decal for material type */
+	const FDecalData& GetImpactDecal(TEnumAsByte<EPhysicalSurface> SurfaceType) const;
+
+private:
+
+	friend class UWSImpactEffectSubsystem;
+
+	/** owned by the impact effect pool */
+	uint8 bPooled : 1;
+
+	/** particles of the current activation, released to the world particle pool on reset */
+	TWeakObjectPtr<UParticleSystemComponent> SpawnedFX;
+
 };
@@ -0,0 +1,70 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "WSTypes.h"
+#include "WSSurfaceEffectData.generated.h"
+
+class USoundCue;
+
+/** effects for a single physical surface */
+USTRUCT(BlueprintType)
+struct FWSSurfaceEffect
+{
+	GENERATED_BODY()
+
+	/** impact FX */
+	UPROPERTY(EditDefaultsOnly, Category=Effect)
+	TObjectPtr<UParticleSystem> FX;
+
+	/** impact sound */
+	UPROPERTY(EditDefaultsOnly, Category=Effect)
+	TObjectPtr<USoundCue> Sound;
+
+	/** impact decal */
+	UPROPERTY(EditDefaultsOnly, Category=Effect)
+	FDecalData Decal;
+
+	FWSSurfaceEffect():
+	FX(nullptr),
+	Sound(nullptr)
+	{
+	}
+};
+
+/**
+ * Surface to impact effect table shared by all impact templates.
+ * Indexed directly by physical surface, empty entries fall back to the default surface.
+ */
+UCLASS(BlueprintType)
+class WEAPONSYSTEM_API UWSSurfaceEffectData : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	/** get FX for surface type */
+	UParticleSystem* GetImpactFX(EPhysicalSurface SurfaceType) const;
+
+	/** get sound for surface type */
+	USoundCue* GetImpactSound(EPhysicalSurface SurfaceType) const;
+
+	/** get decal for surface type */
+	const FDecalData& GetImpactDecal(EPhysicalSurface SurfaceType) const;
+
+protected:
+
+	/** effects per surface type */
+	UPROPERTY(EditDefaultsOnly, Category=Surface, meta=(ArraySizeEnum="EPhysicalSurface"))
+	FWSSurfaceEffect Surfaces[SurfaceType_Max];
+
+private:
+
+	/** get surface entry, invalid surface types use the default one */
+	FORCEINLINE const FWSSurfaceEffect& GetSurfaceEffect(EPhysicalSurface SurfaceType) const
+	{
+		return Surfaces[SurfaceType < SurfaceType_Max ? SurfaceType : SurfaceType_Default];
+	}
+};
@@ -0,0 +1,97 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSDecalSubsystem.generated.h"
+
+class UDecalComponent;
+class UMaterialInterface;
+
+/**
+ * Keeps the number of weapon decals bounded.
+ * Decal components are pooled, the least recently used decal is evicted when the budget is reached,
+ * and decals spawned close to a live one on the same component refresh it instead of adding a new one.
+ */
+UCLASS(Config=Game)
+class WEAPONSYSTEM_API UWSDecalSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	* spawn decal from the pool, same arguments as UGameplayStatics::SpawnDecalAttached
+	*
+	* @param DecalMaterial		Decal material
+	* @param DecalSize			Decal size
+	* @param AttachToComponent	Component to attach to, decal stays in world space if not set
+	* @param AttachPointName	Bone or socket to attach to
+	* @param Location			World location
+	* @param Rotation			World rotation
+	* @param LifeSpan			Decal life span, decal lives until evicted if zero
+	*/
+	UDecalComponent* SpawnDecal(UMaterialInterface* DecalMaterial, const FVector& DecalSize, USceneComponent* AttachToComponent, FName AttachPointName,
+		const FVector& Location, const FRotator& Rotation, float LifeSpan);
+
+	/** number of visible decals */
+	int32 GetNumLiveDecals() const { return LiveDecals.Num(); }
+
+protected:
+
+	/** max number of visible decals */
+	UPROPERTY(Config)
+	int32 MaxDecals = 128;
+
+	/** decals closer than this on the same component are merged (cm) */
+	UPROPERTY(Config)
+	float MergeDistance = 8.0f;
+
+private:
+
+	/** visible decal */
+	struct FLiveDecal
+	{
+		/** index in DecalComponents */
+		int32 DecalIndex;
+
+		/** component decal is attached to */
+		TWeakObjectPtr<USceneComponent> AttachParent;
+
+		/** was decal attached, detects destroyed parents */
+		bool bAttached;
+
+		FVector Location;
+
+		/** release time, zero if decal never expires */
+		double ExpireTime;
+	};
+
+	/** get free decal component, evicts the oldest live decal if budget is reached */
+	int32 AcquireDecal();
+
+	/** create registered world decal component */
+	UDecalComponent* CreateDecalComponent() const;
+
+	/** hide decal and return it to the free list */
+	void ReleaseDecal(int32 LiveIndex);
+
+	/** all created decal components */
+	UPROPERTY()
+	TArray<TObjectPtr<UDecalComponent>> DecalComponents;
+
+	/** free decal components */
+	TArray<int32> FreeDecals;
+
+	/** visible decals, least recently used first */
+	TArray<FLiveDecal> LiveDecals;
+};
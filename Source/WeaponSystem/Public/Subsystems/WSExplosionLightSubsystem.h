@@ -0,0 +1,120 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSExplosionLightSubsystem.generated.h"
+
+class AWSExplosionEffect;
+class UPointLightComponent;
+
+/** light settings of explosion class, read once from class defaults */
+struct FWSExplosionLightSettings
+{
+	float Intensity;
+	float AttenuationRadius;
+	float FadeOut;
+	FLinearColor LightColor;
+	bool bUseInverseSquaredFalloff;
+};
+
+/** fading explosion light */
+struct FWSActiveExplosionLight
+{
+	/** index in light components */
+	int32 LightIndex;
+
+	/** intensity at full brightness */
+	float Intensity;
+
+	float AttenuationRadius;
+	float FadeOut;
+	double StartTime;
+	FVector Location;
+};
+
+/**
+ * Fades all explosion lights from one tick.
+ * Light components are pooled and the number of active lights is capped,
+ * the light with the least peak intensity and lifetime left, weighted by distance to the view,
+ * is replaced when the cap is reached.
+ */
+UCLASS(Config=Game)
+class WEAPONSYSTEM_API UWSExplosionLightSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	* show fading light with settings of explosion class
+	*
+	* @param EffectClass	Explosion class
+	* @param Location		Light location
+	* @return false if light was dropped by the cap
+	*/
+	bool SpawnLight(TSubclassOf<AWSExplosionEffect> EffectClass, const FVector& Location);
+
+	/** number of lights currently fading */
+	int32 GetNumActiveLights() const { return ActiveLights.Num(); }
+
+	/**
+	* how much light contributes to the view, peak intensity scaled by the fraction of its lifetime left
+	*
+	* @param Light			Active or new light
+	* @param ViewLocation	Location of the view
+	* @param Now			Current world time
+	*/
+	static float GetLightImportance(const FWSActiveExplosionLight& Light, const FVector& ViewLocation, double Now);
+
+	/**
+	* find active light to replace by the new one
+	*
+	* @return index in active lights, INDEX_NONE if the new light is the least important one
+	*/
+	static int32 FindLightToEvict(TConstArrayView<FWSActiveExplosionLight> Lights, const FWSActiveExplosionLight& NewLight, const FVector& ViewLocation, double Now);
+
+protected:
+
+	/** max number of lights visible at once */
+	UPROPERTY(Config)
+	int32 MaxActiveLights = 16;
+
+private:
+
+	/** no lights on dedicated servers */
+	bool IsEnabled() const;
+
+	/** light settings of explosion class */
+	const FWSExplosionLightSettings* GetLightSettings(TSubclassOf<AWSExplosionEffect> EffectClass);
+
+	/** free light component index, creates a new one if needed */
+	int32 AcquireLight();
+
+	/** hide light and return it to the pool */
+	void ReleaseLight(int32 ActiveIndex);
+
+	UPointLightComponent* CreateLightComponent() const;
+
+	/** cached settings by explosion class */
+	TMap<TSubclassOf<AWSExplosionEffect>, FWSExplosionLightSettings> LightSettings;
+
+	/** all light components created by subsystem */
+	UPROPERTY()
+	TArray<TObjectPtr<UPointLightComponent>> LightComponents;
+
+	/** indices of hidden light components */
+	TArray<int32> FreeLights;
+
+	/** lights in use */
+	TArray<FWSActiveExplosionLight> ActiveLights;
+};
@@ -0,0 +1,110 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSImpactEffectSubsystem.generated.h"
+
+class AWSImpactEffect;
+
+/** pooled impact effects of one template */
+USTRUCT()
+struct FWSImpactEffectPool
+{
+	GENERATED_BODY()
+
+	/** effects ready for reuse */
+	UPROPERTY()
+	TArray<TObjectPtr<AWSImpactEffect>> FreeEffects;
+
+	/** number of effects owned by the pool, free and active */
+	int32 NumCreated = 0;
+};
+
+/** pooled impact effect in use */
+struct FWSActiveImpactEffect
+{
+	TWeakObjectPtr<AWSImpactEffect> Effect;
+	double ReleaseTime;
+};
+
+/**
+ * Pools impact effect actors per template class, effects are reused instead of spawned and destroyed per hit.
+ * Pools of configured templates are pre-warmed at map load, weapons pre-warm their own templates on begin play.
+ */
+UCLASS(Config=Game)
+class WEAPONSYSTEM_API UWSImpactEffectSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	* activate pooled impact effect, spawns a new one if the pool is empty
+	*
+	* @param Template		Effect class
+	* @param Transform		Effect transform
+	* @param SurfaceHit		Hit to spawn effect for
+	* @param SurfaceType	Surface type used when hit has no physical material
+	*/
+	AWSImpactEffect* SpawnImpactEffect(TSubclassOf<AWSImpactEffect> Template, const FTransform& Transform, const FHitResult& SurfaceHit, EPhysicalSurface SurfaceType);
+
+	/** make sure template pool has at least Count effects, configured PrewarmCount is used by default */
+	void PrewarmPool(TSubclassOf<AWSImpactEffect> Template, int32 Count = INDEX_NONE);
+
+	/** number of effects taken from a pool */
+	int32 GetNumPoolHits() const { return NumPoolHits; }
+
+	/** number of effects spawned because a pool was empty */
+	int32 GetNumPoolMisses() const { return NumPoolMisses; }
+
+protected:
+
+	/** templates pre-warmed at map load */
+	UPROPERTY(Config)
+	TArray<TSoftClassPtr<AWSImpactEffect>> PrewarmTemplates;
+
+	/** number of effects created per template on pre-warm */
+	UPROPERTY(Config)
+	int32 PrewarmCount = 8;
+
+	/** max number of effects per template, effects over the limit are not pooled */
+	UPROPERTY(Config)
+	int32 MaxPoolSize = 64;
+
+	/** time effect stays active before it returns to the pool (seconds) */
+	UPROPERTY(Config)
+	float PooledLifeSpan = 3.0f;
+
+private:
+
+	/** no effects on dedicated servers */
+	bool IsPoolingEnabled() const;
+
+	/** spawn new pooled effect */
+	AWSImpactEffect* CreatePooledEffect(TSubclassOf<AWSImpactEffect> Template, FWSImpactEffectPool& Pool);
+
+	/** reset effect and return it to its pool */
+	void ReturnToPool(AWSImpactEffect* Effect);
+
+	/** pools by template */
+	UPROPERTY()
+	TMap<TSubclassOf<AWSImpactEffect>, FWSImpactEffectPool> Pools;
+
+	/** effects in use, ordered by release time */
+	TArray<FWSActiveImpactEffect> ActiveEffects;
+
+	/** pool stats */
+	int32 NumPoolHits = 0;
+	int32 NumPoolMisses = 0;
+};
@@ -0,0 +1,125 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSLagCompensationSubsystem.generated.h"
+
+/** result of a rewound hit test */
+enum class EWSRewindHitResult : uint8
+{
+	/** actor has no history for requested time */
+	NotTracked,
+	/** hit is inside the rewound hitbox */
+	Hit,
+	/** hit is outside the rewound hitbox */
+	Miss,
+};
+
+/**
+ * [server] Records compact hitbox history of pawns and validates client hits against the past.
+ * History is a fixed size ring buffer stored as structure of arrays: [Frame * MaxTrackedActors + Slot].
+ * Memory is allocated once and does not grow with the number of pawns, pawns over the limit are not tracked.
+ */
+UCLASS(Config=Game)
+class WEAPONSYSTEM_API UWSLagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** start recording actor hitbox, returns false if there is no free slot */
+	bool RegisterActor(AActor* Actor);
+
+	/** stop recording actor hitbox */
+	void UnregisterActor(AActor* Actor);
+
+	/** get actor hitbox at given server time, interpolated between recorded frames */
+	bool GetRewoundBox(const AActor* Actor, double Time, FBox& OutBox) const;
+
+	/**
+	* test client hit against rewound hitbox with a single ray/box test
+	*
+	* @param Actor		Hit actor
+	* @param Time		Server time to rewind to
+	* @param TraceStart	Shot origin
+	* @param HitLocation	Reported hit location
+	* @param Tolerance	Hitbox expansion (cm)
+	*/
+	EWSRewindHitResult ValidateHit(const AActor* Actor, double Time, const FVector& TraceStart, const FVector& HitLocation, float Tolerance) const;
+
+	/** convert client's shot timestamp (estimated server time) to the time the shooter saw on screen */
+	double GetShotRewindTime(const APawn* Shooter, double ClientShotTime) const;
+
+protected:
+
+	/** max number of recorded actors */
+	UPROPERTY(Config)
+	int32 MaxTrackedActors = 128;
+
+	/** number of recorded frames */
+	UPROPERTY(Config)
+	int32 HistoryLength = 32;
+
+	/** max time the server is allowed to rewind (seconds) */
+	UPROPERTY(Config)
+	float MaxRewindTime = 0.4f;
+
+private:
+
+	/** history is recorded only on servers with remote clients */
+	bool IsRecording() const;
+
+	/** auto register spawned pawns */
+	void OnActorSpawned(AActor* Actor);
+
+	/** free slot for reuse */
+	void ReleaseSlot(int32 Slot);
+
+	/** find buffer index of the actor's slot in the frame */
+	FORCEINLINE int32 GetBufferIndex(int32 Frame, int32 Slot) const { return Frame * MaxTrackedActors + Slot; }
+
+	/** actor of each slot */
+	TArray<TWeakObjectPtr<AActor>> SlotActors;
+
+	/** actor key of each slot, valid after the actor is destroyed */
+	TArray<TObjectKey<AActor>> SlotKeys;
+
+	/** time when slot started recording */
+	TArray<double> SlotStartTimes;
+
+	/** free slots */
+	TArray<int32> FreeSlots;
+
+	/** slot lookup */
+	TMap<TObjectKey<AActor>, int32> ActorSlots;
+
+	/** time of each recorded frame */
+	TArray<double> FrameTimes;
+
+	/** hitbox centers, all slots of a frame are contiguous */
+	TArray<FVector3f> BoxCenters;
+
+	/** hitbox extents, all slots of a frame are contiguous */
+	TArray<FVector3f> BoxExtents;
+
+	/** most recently recorded frame */
+	int32 NewestFrame = INDEX_NONE;
+
+	/** number of valid frames */
+	int32 NumFrames = 0;
+
+	/** spawn handler */
+	FDelegateHandle ActorSpawnedHandle;
+};
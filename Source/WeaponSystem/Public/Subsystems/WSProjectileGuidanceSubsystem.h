@@ -0,0 +1,135 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSProjectileGuidanceSubsystem.generated.h"
+
+class AWSProjectile;
+
+/** registered guided projectile */
+struct FWSGuidedProjectile
+{
+	/** cleared on unregister, entry is removed on the next tick */
+	TWeakObjectPtr<AWSProjectile> Projectile;
+
+	/** locked target of homing projectile */
+	TWeakObjectPtr<AActor> Target;
+
+	/** homing projectile without target looks for one at this time */
+	double NextAcquireTime;
+};
+
+/** projectile state gathered on the game thread for batched steering */
+struct FWSGuidanceQuery
+{
+	FVector Location;
+	FVector Velocity;
+
+	/** point guided projectile steers to */
+	FVector AimLocation;
+
+	/** actor that fired the projectile, never selected as target */
+	const AActor* Instigator;
+
+	float TurnRate;
+	float HomingRadius;
+	float HomingCosAngle;
+
+	/** index in targets, INDEX_NONE when projectile has no target */
+	int32 TargetIndex;
+
+	bool bHoming;
+	bool bHasAimLocation;
+	bool bAcquireTarget;
+};
+
+/**
+ * Steers guided and homing projectile actors in one batched pass per tick.
+ * Candidate targets are gathered once per frame into a spatial hash shared by all homing projectiles,
+ * target selection and steering run over all projectiles in chunks on worker threads and results are applied
+ * to projectile movement on the game thread.
+ * Projectiles are steered on the server only, clients receive replicated movement.
+ */
+UCLASS(Config=Game)
+class WEAPONSYSTEM_API UWSProjectileGuidanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** [server] start steering projectile with guidance */
+	void RegisterProjectile(AWSProjectile* Projectile);
+
+	/** [server] stop steering projectile */
+	void UnregisterProjectile(AWSProjectile* Projectile);
+
+	/** number of guided projectiles */
+	int32 GetNumProjectiles() const { return Projectiles.Num(); }
+
+protected:
+
+	/** size of target hash cell */
+	UPROPERTY(Config)
+	float CellSize = 2000.0f;
+
+	/** time between target searches of homing projectile without target (seconds) */
+	UPROPERTY(Config)
+	float AcquireInterval = 0.2f;
+
+	/** steer chunks on worker threads */
+	UPROPERTY(Config)
+	bool bParallelSteering = true;
+
+	/** number of projectiles steered together by one worker */
+	UPROPERTY(Config)
+	int32 ChunkSize = 64;
+
+private:
+
+	/** gather candidate targets into spatial hash */
+	void BuildTargetIndex();
+
+	/**
+	* [worker] best target in the seeker cone of projectile
+	*
+	* @return index in targets or INDEX_NONE
+	*/
+	int32 SelectTarget(const FWSGuidanceQuery& Query) const;
+
+	/** [worker] is target inside the seeker cone of projectile */
+	bool IsTargetInCone(const FWSGuidanceQuery& Query, const FVector& TargetLocation) const;
+
+	/** [worker] velocity turned toward the goal by the turn rate */
+	static FVector SteerVelocity(const FVector& Location, const FVector& Velocity, const FVector& Goal, float MaxAngle);
+
+	/** remove unregistered entries, last entry takes the place */
+	void CompactProjectiles();
+
+	FIntVector GetCell(const FVector& Location) const;
+
+	/** registered projectiles */
+	TArray<FWSGuidedProjectile> Projectiles;
+
+	/** candidate targets of this frame */
+	TArray<TWeakObjectPtr<AActor>> Targets;
+	TArray<const AActor*> TargetKeys;
+	TArray<FVector> TargetLocations;
+
+	/** target indices by hash cell */
+	TMap<FIntVector, TArray<int32>> TargetCells;
+
+	/** steering input and output, reused between ticks */
+	TArray<FWSGuidanceQuery> Queries;
+	TArray<FVector> NewVelocities;
+	TArray<int32> NewTargets;
+};
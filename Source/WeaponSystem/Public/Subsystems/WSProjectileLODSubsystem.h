@@ -0,0 +1,112 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSProjectileLODSubsystem.generated.h"
+
+class AWSProjectile;
+
+/** update level of projectile actor, higher levels update less often */
+enum class EWSProjectileLOD : uint8
+{
+	Near,
+	Medium,
+	Far,
+};
+
+/** registered projectile */
+struct FWSProjectileLODState
+{
+	/** cleared on unregister, entry is removed on the next tick */
+	TWeakObjectPtr<AWSProjectile> Projectile;
+
+	/** time since the last movement update */
+	float PendingTime;
+
+	/** current update level */
+	EWSProjectileLOD LOD;
+
+	/** particles and sound are on */
+	bool bCosmeticsEnabled;
+};
+
+/**
+ * Updates movement of projectile actors by significance.
+ * Projectiles far from all players or not rendered recently move at a reduced rate, their movement is swept
+ * over the whole skipped time so collisions are not missed. Far projectiles also disable particles and sound.
+ * Movement updates are capped by time budget, projectiles left over keep their pending time and are updated first
+ * on the next tick.
+ */
+UCLASS(Config=Game)
+class WEAPONSYSTEM_API UWSProjectileLODSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** start updating projectile movement, projectile keeps its own movement tick when LOD is disabled */
+	void RegisterProjectile(AWSProjectile* Projectile);
+
+	/** stop updating projectile movement and restore its own movement tick, cosmetics are restored by projectile reset */
+	void UnregisterProjectile(AWSProjectile* Projectile);
+
+	/** number of registered projectiles */
+	int32 GetNumProjectiles() const { return Projectiles.Num(); }
+
+protected:
+
+	/** update projectile actors by significance, every projectile updates on every tick otherwise */
+	UPROPERTY(Config)
+	bool bEnableProjectileLOD = true;
+
+	/** distance to the closest player from which projectile updates at medium rate */
+	UPROPERTY(Config)
+	float MediumDistance = 2500.0f;
+
+	/** distance to the closest player from which projectile updates at far rate */
+	UPROPERTY(Config)
+	float FarDistance = 6000.0f;
+
+	/** time between movement updates at medium level (seconds) */
+	UPROPERTY(Config)
+	float MediumUpdateInterval = 0.033f;
+
+	/** time between movement updates at far level (seconds) */
+	UPROPERTY(Config)
+	float FarUpdateInterval = 0.1f;
+
+	/** projectile not rendered for this long drops one level, particles and sound are turned off only by distance (seconds) */
+	UPROPERTY(Config)
+	float UnobservedTime = 0.5f;
+
+	/** max time spent on projectile movement per tick (milliseconds) */
+	UPROPERTY(Config)
+	float TimeBudgetMs = 1.0f;
+
+private:
+
+	/** level from distance to the closest view */
+	EWSProjectileLOD GetDistanceLOD(const FVector& Location, TConstArrayView<FVector> ViewLocations) const;
+
+	/** time between movement updates of level */
+	float GetUpdateInterval(EWSProjectileLOD LOD) const;
+
+	/** remove unregistered entries, last entry takes the place */
+	void CompactProjectiles();
+
+	/** registered projectiles */
+	TArray<FWSProjectileLODState> Projectiles;
+
+	/** projectiles due for update, reused between ticks */
+	TArray<int32> DueProjectiles;
+};
@@ -0,0 +1,88 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSProjectilePoolSubsystem.generated.h"
+
+class AWSProjectile;
+
+/** pooled projectiles of one class */
+USTRUCT()
+struct FWSProjectilePool
+{
+	GENERATED_BODY()
+
+	/** dormant projectiles ready for reuse */
+	UPROPERTY()
+	TArray<TObjectPtr<AWSProjectile>> FreeProjectiles;
+
+	/** number of projectiles owned by the pool, free and active */
+	int32 NumCreated = 0;
+};
+
+/**
+ * [server] Pools replicated projectiles per class.
+ * Free projectiles are hidden and net dormant, reuse wakes them up instead of spawning a new actor.
+ */
+UCLASS(Config=Game)
+class WEAPONSYSTEM_API UWSProjectilePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/**
+	* activate pooled projectile, spawns a new one if the pool is empty
+	*
+	* @param ProjectileClass	Projectile class
+	* @param SpawnTransform		Projectile transform
+	* @param Owner				Weapon that fired the projectile
+	* @param Instigator			Pawn that fired the projectile
+	* @param ShootDir			Initial direction
+	*/
+	AWSProjectile* SpawnProjectile(TSubclassOf<AWSProjectile> ProjectileClass, const FTransform& SpawnTransform, AActor* Owner, APawn* Instigator, const FVector& ShootDir);
+
+	/** deactivate projectile and return it to its pool */
+	void ReleaseProjectile(AWSProjectile* Projectile);
+
+	/** make sure class pool has at least Count projectiles, configured PrewarmCount is used by default */
+	void PrewarmPool(TSubclassOf<AWSProjectile> ProjectileClass, int32 Count = INDEX_NONE);
+
+	/** number of projectiles taken from a pool */
+	int32 GetNumPoolHits() const { return NumPoolHits; }
+
+	/** number of projectiles spawned because a pool was empty */
+	int32 GetNumPoolMisses() const { return NumPoolMisses; }
+
+protected:
+
+	/** number of projectiles created per class on pre-warm */
+	UPROPERTY(Config)
+	int32 PrewarmCount = 4;
+
+	/** max number of projectiles per class, projectiles over the limit are not pooled */
+	UPROPERTY(Config)
+	int32 MaxPoolSize = 32;
+
+private:
+
+	/** projectiles are spawned by server only */
+	bool IsPoolingEnabled() const;
+
+	/** spawn new dormant projectile */
+	AWSProjectile* CreatePooledProjectile(TSubclassOf<AWSProjectile> ProjectileClass, FWSProjectilePool& Pool);
+
+	/** pools by class */
+	UPROPERTY()
+	TMap<TSubclassOf<AWSProjectile>, FWSProjectilePool> Pools;
+
+	/** pool stats */
+	int32 NumPoolHits = 0;
+	int32 NumPoolMisses = 0;
+};
@@ -0,0 +1,198 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSWeapon_Projectile.h"
+#include "WSProjectileSimSubsystem.generated.h"
+
+class AWSProjectile;
+class AWSProjectileSimReplicator;
+class AWSExplosionEffect;
+class UParticleSystem;
+class UParticleSystemComponent;
+
+/** movement and explosion settings shared by simulated projectiles of one weapon class */
+USTRUCT()
+struct FWSProjectileSimConfig
+{
+	GENERATED_BODY()
+
+	/** weapon class the config was built from */
+	UPROPERTY()
+	TSubclassOf<AWSWeapon_Projectile> WeaponClass;
+
+	/** weapon projectile config */
+	UPROPERTY()
+	FProjectileWeaponData WeaponConfig;
+
+	/** effects for explosion, taken from projectile class */
+	UPROPERTY()
+	TSubclassOf<AWSExplosionEffect> ExplosionTemplate;
+
+	/** trail effect of projectile class */
+	UPROPERTY()
+	TObjectPtr<UParticleSystem> TrailFX;
+
+	/** collision responses of projectile class */
+	UPROPERTY()
+	FCollisionResponseContainer CollisionResponses;
+
+	/** sweep radius, zero uses line traces */
+	float CollisionRadius;
+
+	/** speed along shoot direction at spawn */
+	float InitialSpeed;
+
+	/** speed limit, zero means no limit */
+	float MaxSpeed;
+
+	/** defaults */
+	FWSProjectileSimConfig():
+		CollisionRadius(0.0f),
+		InitialSpeed(0.0f),
+		MaxSpeed(0.0f)
+	{
+	}
+};
+
+/** simulated projectile that hit something or ran out of life time */
+struct FWSProjectileSimResult
+{
+	/** projectile index */
+	int32 Index;
+
+	/** blocking hit if projectile should explode */
+	FHitResult Impact;
+};
+
+/**
+ * Simulates projectiles without actors.
+ * Projectiles are stored as structure of arrays and are integrated and swept in one batched pass per tick.
+ * Projectiles are updated in chunks on worker threads, results are applied on the game thread in projectile order.
+ * Projectiles not updated within the time budget keep their pending time and are updated first on the next tick.
+ * Impacts apply damage and spawn explosion effects the same way projectile actors do.
+ *
+ * Server projectiles are replicated as spawn records, clients simulate them locally without damage and only
+ * explosions are replicated. Records are sent in batches once per tick by an always relevant replicator actor,
+ * so they don't depend on relevancy of the weapon that fired them. Spawn records are unreliable, explosions reliable.
+ */
+UCLASS(Config=Game)
+class WEAPONSYSTEM_API UWSProjectileSimSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	* add simulated projectile, clients fast-forward it by the time passed since server spawn
+	*
+	* @param Weapon			[server] Weapon that fired the projectile, clients pass null and use replicated record
+	* @param SpawnRecord	Spawn parameters
+	* @return false if projectile limit is reached
+	*/
+	bool SpawnProjectile(AWSWeapon_Projectile* Weapon, const FProjectileSpawnRecord& SpawnRecord);
+
+	/**
+	* [client] remove projectile and spawn its explosion
+	*
+	* @param Record		Replicated explosion
+	*/
+	void ExplodeProjectile(const FProjectileExplosionRecord& Record);
+
+	/** number of simulated projectiles */
+	int32 GetNumProjectiles() const { return Positions.Num(); }
+
+protected:
+
+	/** max number of simulated projectiles, new projectiles over the limit are not spawned */
+	UPROPERTY(Config)
+	int32 MaxProjectiles = 16384;
+
+	/** max time spent on simulation per tick (milliseconds) */
+	UPROPERTY(Config)
+	float TimeBudgetMs = 2.0f;
+
+	/** update chunks on worker threads */
+	UPROPERTY(Config)
+	bool bParallelSimulation = true;
+
+	/** number of projectiles updated together by one worker */
+	UPROPERTY(Config)
+	int32 ChunkSize = 256;
+
+	/** max number of records sent in one multicast */
+	UPROPERTY(Config)
+	int32 MaxRecordsPerBatch = 64;
+
+private:
+
+	/** find or build config of weapon class */
+	int32 GetConfigIndex(TSubclassOf<AWSWeapon_Projectile> WeaponClass);
+
+	/** move projectiles by the time passed since their last update */
+	void SimulateProjectiles(float DeltaTime);
+
+	/** [server] send spawn and explosion records queued during the tick */
+	void ReplicateRecords();
+
+	/**
+	* [worker] move projectile by its pending time, only touches state of this projectile
+	*
+	* @return true if projectile hit something or ran out of life time
+	*/
+	bool SimulateProjectile(int32 Index, float GravityZ, FHitResult& OutImpact);
+
+	/** [game thread] explode and remove finished projectiles */
+	void ApplyResults();
+
+	/** [game thread] move trail effects to projectiles */
+	void UpdateVisuals();
+
+	/** remove projectile, last projectile takes its place */
+	void RemoveProjectile(int32 Index);
+
+	/** configs by weapon class */
+	UPROPERTY()
+	TArray<FWSProjectileSimConfig> Configs;
+
+	/** projectile state */
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<float> GravityScales;
+	TArray<float> RemainingLifes;
+	TArray<float> PendingTimes;
+	TArray<int32> ConfigIndices;
+	TArray<TWeakObjectPtr<AWSWeapon_Projectile>> Owners;
+	TArray<TWeakObjectPtr<APawn>> Instigators;
+	TArray<TWeakObjectPtr<AController>> InstigatorControllers;
+	TArray<uint16> ProjectileIds;
+	TArray<TWeakObjectPtr<UParticleSystemComponent>> Visuals;
+
+	/** first projectile to update on the next tick */
+	int32 NextIndex = 0;
+
+	/** finished projectiles per chunk, filled by workers */
+	TArray<TArray<FWSProjectileSimResult>> ChunkResults;
+
+	/** [server] channel for records */
+	UPROPERTY()
+	TObjectPtr<AWSProjectileSimReplicator> Replicator;
+
+	/** [server] records waiting to be sent */
+	TArray<FProjectileSpawnRecord> PendingSpawnRecords;
+	TArray<FProjectileExplosionRecord> PendingExplosions;
+
+	/** [server] id of the last spawned projectile */
+	uint16 ProjectileCounter = 0;
+};
@@ -0,0 +1,95 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSRadialDamageSubsystem.generated.h"
+
+class UDamageType;
+
+/** explosion waiting for damage resolve */
+struct FWSRadialDamageRequest
+{
+	FVector Origin;
+	float BaseDamage;
+	float Radius;
+	TSubclassOf<UDamageType> DamageType;
+	TWeakObjectPtr<AActor> DamageCauser;
+	TWeakObjectPtr<AController> InstigatorController;
+};
+
+/** summed damage of one actor from explosions of the same instigator, causer and damage type */
+struct FWSRadialDamageTarget
+{
+	TSubclassOf<UDamageType> DamageType;
+	TWeakObjectPtr<AActor> DamageCauser;
+	TWeakObjectPtr<AController> InstigatorController;
+
+	/** sum of all explosions */
+	float TotalDamage;
+
+	/** explosion that did the most damage, its hits are passed to the damage event */
+	float MaxDamage;
+	int32 MaxDamageRequest;
+	TArray<FHitResult> MaxDamageHits;
+};
+
+/**
+ * Resolves radial damage of all explosions queued during the frame in one pass.
+ * Explosions are grouped by grid cell and each cell runs a single overlap for all its explosions.
+ * Visibility traces are shared by explosions with close origins, each actor takes summed damage in one TakeDamage call.
+ * Damage falloff matches UGameplayStatics::ApplyRadialDamage.
+ */
+UCLASS(Config=Game)
+class WEAPONSYSTEM_API UWSRadialDamageSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** are explosions queued, ApplyRadialDamage is used directly otherwise */
+	bool IsBatchingEnabled() const { return bBatchRadialDamage; }
+
+	/**
+	* queue explosion damage, applied at the end of the frame
+	*
+	* @param BaseDamage				Damage at explosion origin
+	* @param Origin					Explosion origin
+	* @param Radius					Damage radius
+	* @param DamageType				Type of damage
+	* @param DamageCauser			Actor causing the damage
+	* @param InstigatorController	Controller responsible for the damage
+	*/
+	void QueueRadialDamage(float BaseDamage, const FVector& Origin, float Radius, TSubclassOf<UDamageType> DamageType, AActor* DamageCauser, AController* InstigatorController);
+
+protected:
+
+	/** queue explosions instead of applying damage right away */
+	UPROPERTY(Config)
+	bool bBatchRadialDamage = true;
+
+	/** size of broadphase grid cell, explosions in one cell share an overlap query */
+	UPROPERTY(Config)
+	float CellSize = 2000.0f;
+
+	/** explosions with origins in the same cell of this size share visibility traces */
+	UPROPERTY(Config)
+	float TraceShareDistance = 50.0f;
+
+private:
+
+	/** apply damage of all queued explosions */
+	void ResolvePendingDamage();
+
+	/** explosions queued this frame */
+	TArray<FWSRadialDamageRequest> PendingRequests;
+};
@@ -0,0 +1,74 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSTraceSubsystem.generated.h"
+
+/** called when all traces of the queued batch have results, hits are in the same order as trace ends */
+DECLARE_DELEGATE_OneParam(FWSTraceBatchResultDelegate, TConstArrayView<FHitResult> /*Hits*/);
+
+/**
+ * Collects weapon traces of the whole world and runs them as one async batch.
+ * Traces queued during the frame are dispatched together, results are delivered on the next frame.
+ */
+UCLASS()
+class WEAPONSYSTEM_API UWSTraceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** max number of traces in a single batch (limited by trace user data packing) */
+	static constexpr int32 MaxTracesPerBatch = 256;
+
+	// USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	* queue line traces sharing the same start for the current frame batch
+	*
+	* @param Start			Trace start
+	* @param Ends			Trace ends, one trace per entry
+	* @param TraceChannel	Collision channel
+	* @param Params			Query params (copied)
+	* @param OnComplete		Executed on game thread when results of all traces are available
+	*/
+	void QueueLineTraceBatch(const FVector& Start, TConstArrayView<FVector> Ends, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, FWSTraceBatchResultDelegate&& OnComplete);
+
+	/** number of batches queued or waiting for results */
+	int32 GetNumPendingBatches() const;
+
+private:
+
+	/** traces queued by one request */
+	struct FTraceBatch
+	{
+		FVector Start;
+		TArray<FVector, TInlineAllocator<1>> Ends;
+		ECollisionChannel TraceChannel;
+		FCollisionQueryParams Params;
+		TArray<FHitResult, TInlineAllocator<1>> Hits;
+		int32 NumPendingHits;
+		FWSTraceBatchResultDelegate OnComplete;
+	};
+
+	/** async trace results handler */
+	void OnTraceCompleted(const FTraceHandle& Handle, FTraceDatum& Data);
+
+	/** queued and in flight batches, index is packed into trace user data */
+	TSparseArray<FTraceBatch> Batches;
+
+	/** batches queued this frame */
+	TArray<int32> QueuedBatches;
+
+	/** shared delegate for all dispatched traces */
+	FTraceDelegate TraceDelegate;
+};
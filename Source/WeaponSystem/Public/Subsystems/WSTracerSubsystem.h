@@ -0,0 +1,84 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSTracerSubsystem.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+
+/**
+ * Spawns weapon tracer trails from the world particle pool.
+ * Tracers of remote shooters are culled by distance and view, thinned out with distance and capped per frame.
+ */
+UCLASS(Config=Game)
+class WEAPONSYSTEM_API UWSTracerSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// USubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/**
+	* spawn tracer if it passes culling
+	*
+	* @param TrailFX		Trail particle system
+	* @param TargetParam	Beam target parameter name
+	* @param Origin		Trail start
+	* @param EndPoint		Trail end
+	* @param bImportant	Skip culling, e.g. for locally controlled shooter
+	*/
+	UParticleSystemComponent* SpawnTracer(UParticleSystem* TrailFX, FName TargetParam, const FVector& Origin, const FVector& EndPoint, bool bImportant);
+
+protected:
+
+	/** max number of new culled tracers per frame */
+	UPROPERTY(Config)
+	int32 MaxTracersPerFrame = 32;
+
+	/** tracers farther from the view are not spawned (cm) */
+	UPROPERTY(Config)
+	float CullDistance = 10000.0f;
+
+	/** tracers farther from the view are thinned out, up to MaxThinningStep at cull distance (cm) */
+	UPROPERTY(Config)
+	float ThinningDistance = 3000.0f;
+
+	/** only every Nth tracer is spawned at cull distance */
+	UPROPERTY(Config)
+	int32 MaxThinningStep = 4;
+
+	/** cull tracers outside of the view */
+	UPROPERTY(Config)
+	bool bCullOutsideView = true;
+
+private:
+
+	/** check tracer against the local view */
+	bool ShouldSpawnTracer(const FVector& Origin, const FVector& EndPoint);
+
+	/** refresh cached view and frame counters once per frame */
+	void UpdateFrame();
+
+	/** frame of cached data */
+	uint64 CachedFrame = 0;
+
+	/** local view is valid */
+	bool bHasView = false;
+
+	FVector ViewLocation = FVector::ZeroVector;
+	FVector ViewDir = FVector::ForwardVector;
+
+	/** cos of half view angle with a margin */
+	float ViewCosHalfAngle = 0.0f;
+
+	/** tracers spawned this frame */
+	int32 NumFrameTracers = 0;
+
+	/** rotating counter for thinning */
+	uint32 ThinningCounter = 0;
+};
@@ -0,0 +1,149 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WSWeaponTimerSubsystem.generated.h"
+
+class AWSWeapon;
+
+/** weapon function called when timer expires */
+typedef void (AWSWeapon::*FWSWeaponTimerFunc)();
+
+/** handle of weapon timer, stays invalid after timer expired or was cleared */
+struct FWSWeaponTimerHandle
+{
+	/** index in timer pool */
+	int32 Index = INDEX_NONE;
+
+	/** serial of timer in the pool slot, zero is never used */
+	uint32 Serial = 0;
+
+	void Invalidate()
+	{
+		Index = INDEX_NONE;
+		Serial = 0;
+	}
+};
+
+/** scheduled weapon timer */
+struct FWSWeaponTimer
+{
+	TWeakObjectPtr<AWSWeapon> Weapon;
+	FWSWeaponTimerFunc Func;
+	double ExpireTime;
+
+	/** wheel tick timer is filed under */
+	int64 Tick;
+
+	/** list links, wheel slot list or free list */
+	int32 Prev;
+	int32 Next;
+
+	/** list timer is linked into, INDEX_NONE when free or waiting for dispatch */
+	int32 List;
+
+	uint32 Serial;
+};
+
+/**
+ * Hierarchical timer wheel for weapon refire, reload and equip timers.
+ * Timers live in a pool and are linked into wheel slots by expire time, so scheduling and clearing allocate nothing
+ * and cost the same with any number of weapons. The near level covers refire intervals slot by slot, the far level
+ * and the overflow list are moved down as the wheel turns. Due timers are gathered into one batch per tick and
+ * called in expire order, timers fire on the first tick their expire time is reached like timer manager timers.
+ */
+UCLASS(Config=Game)
+class WEAPONSYSTEM_API UWSWeaponTimerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	* call weapon function after delay, replaces timer of handle
+	*
+	* @param Handle		Timer handle, cleared when rate is not positive
+	* @param Weapon		Weapon to call function on
+	* @param Func		Weapon function
+	* @param Rate		Delay (seconds)
+	*/
+	void SetTimer(FWSWeaponTimerHandle& Handle, AWSWeapon* Weapon, FWSWeaponTimerFunc Func, float Rate);
+
+	/** stop timer and invalidate handle */
+	void ClearTimer(FWSWeaponTimerHandle& Handle);
+
+	/** is timer of handle waiting to expire */
+	bool IsTimerActive(const FWSWeaponTimerHandle& Handle) const;
+
+	/** number of scheduled timers */
+	int32 GetNumTimers() const { return NumTimers; }
+
+protected:
+
+	/** time covered by one wheel slot (seconds) */
+	UPROPERTY(Config)
+	float SlotDuration = 0.005f;
+
+private:
+
+	/** slots of the near level, one tick each */
+	static constexpr int32 NearBits = 8;
+	static constexpr int32 NumNearSlots = 1 << NearBits;
+
+	/** slots of the far level, one near level turn each */
+	static constexpr int32 FarBits = 6;
+	static constexpr int32 NumFarSlots = 1 << FarBits;
+
+	/** lists: near slots, far slots, overflow */
+	static constexpr int32 OverflowList = NumNearSlots + NumFarSlots;
+	static constexpr int32 NumLists = OverflowList + 1;
+
+	/** link timer into list of wheel level matching its tick */
+	void Schedule(int32 Index);
+
+	/** move all timers of list back into the wheel */
+	void Cascade(int32 List);
+
+	/** link and unlink timer */
+	void LinkTimer(int32 Index, int32 List);
+	void UnlinkTimer(int32 Index);
+
+	/** take timer from pool */
+	int32 AllocateTimer();
+
+	/** return timer to pool, handles of it become invalid */
+	void FreeTimer(int32 Index);
+
+	/** move due timers of near slot to the batch, timers not due yet are moved to the last tick */
+	void CollectDueTimers(int32 List, double Now, int64 LastTick);
+
+	int64 GetTick(double Time) const;
+
+	/** timer pool */
+	TArray<FWSWeaponTimer> Timers;
+
+	/** first timer of each list */
+	TArray<int32> ListHeads;
+
+	/** first free timer of the pool */
+	int32 FreeHead = INDEX_NONE;
+
+	/** tick the wheel was last processed up to, its slot may still hold later timers */
+	int64 CurrentTick = 0;
+
+	int32 NumTimers = 0;
+
+	/** due timers of this tick, reused between ticks */
+	TArray<FWSWeaponTimerHandle> DueTimers;
+};
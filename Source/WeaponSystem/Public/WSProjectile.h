@@ -25,14 +25,82 @@ public:
 	/** initial setup */
 	virtual void PostInitializeComponents() override;
 
+	/** start update by projectile LOD and guidance */
+	virtual void BeginPlay() override;
+
+	/** stop update by projectile LOD and guidance */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	/** setup velocity */
-	void InitVelocity(FVector& ShootDirection);
+	void InitVelocity(const FVector& ShootDirection);
 
 	/** handle hit */
 	UFUNCTION()
 	void OnImpact(const FHitResult& HitResult);
 
+	/** [server] reset and launch projectile taken from the pool */
+	void ActivateFromPool(const FTransform& SpawnTransform, AActor* InOwner, APawn* InInstigator, const FVector& ShootDirection);
+
+	/** [server] stop and hide projectile, it stays net dormant until the next activation */
+	void DeactivateToPool();
+
+	/** is projectile waiting in the pool */
+	bool IsInPool() const { return bInPool; }
+
+	/** pooled projectiles return to the pool instead of being destroyed */
+	virtual void LifeSpanExpired() override;
+
+	/** blend predicted visual offset */
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** [client] replace predicted projectile of the owning weapon */
+	virtual void PostNetInit() override;
+
+	/** [local] mark as predicted projectile, must be called before spawn is finished */
+	void InitPredictedProjectile();
+
+	/** move projectile forward in time, catches up with client prediction and updates projectiles with reduced LOD */
+	void FastForward(float DeltaTime);
+
+	/** show or hide particles and sound, far projectiles run without them */
+	void SetCosmeticsEnabled(bool bEnabled);
+
+	/**
+	* apply explosion damage and spawn explosion effect, shared by projectile actors and actorless projectiles
+	*
+	* @param World					World to explode in
+	* @param Impact					Projectile impact
+	* @param Config					Weapon config of the projectile
+	* @param ExplosionTemplate		Explosion effect class
+	* @param DamageCauser			Actor causing the damage
+	* @param InstigatorController	Controller that fired the projectile
+	* @param SurfaceType			Surface hit by projectile, for impacts without physical material
+	*/
+	static void SpawnExplosion(UWorld* World, const FHitResult& Impact, const FProjectileWeaponData& Config, TSubclassOf<AWSExplosionEffect> ExplosionTemplate,
+		AActor* DamageCauser, AController* InstigatorController, EPhysicalSurface SurfaceType = SurfaceType_Default);
+
 private:
+
+	friend class UWSProjectilePoolSubsystem;
+	friend class UWSProjectileSimSubsystem;
+	friend class UWSProjectileLODSubsystem;
+	friend class UWSProjectileGuidanceSubsystem;
+
+	/** owned by the projectile pool */
+	uint8 bPooled : 1;
+
+	/** waiting in the pool */
+	uint8 bInPool : 1;
+
+	/** [local] cosmetic projectile of the owning client, never explodes */
+	uint8 bPredicted : 1;
+
+	/** index in projectile LOD subsystem, INDEX_NONE when projectile moves on its own tick */
+	int32 LODIndex;
+
+	/** index in projectile guidance subsystem, INDEX_NONE when projectile is not steered */
+	int32 GuidanceIndex;
+
 	/** movement component */
 	UPROPERTY(VisibleDefaultsOnly, Category=Projectile)
 	TObjectPtr<UProjectileMovementComponent> MovementComp;
@@ -57,15 +125,48 @@ protected:
 	struct FProjectileWeaponData WeaponConfig;
 
 	/** did it explode? */
-	UPROPERTY(Transient, ReplicatedUsing=OnRep_Exploded)
 	bool bExploded;
 
+	/** [server] explosion impact, clients spawn explosion from it without tracing */
+	UPROPERTY(Transient, ReplicatedUsing=OnRep_Exploded)
+	FProjectileExplosionInfo ExplosionInfo;
+
 	/** [client] explosion happened */
 	UFUNCTION()
 	void OnRep_Exploded();
 
+	/** incremented on every activation from the pool */
+	UPROPERTY(Transient, ReplicatedUsing=OnRep_PoolGeneration)
+	uint8 PoolGeneration;
+
+	/** [client] projectile was reused */
+	UFUNCTION()
+	void OnRep_PoolGeneration();
+
+	/** show projectile and restart movement and particles */
+	void ResetProjectile();
+
+	/** take weapon config, controller and instigator collision ignore from current owner and instigator */
+	void SetupFromOwner();
+
+	/** [server] start steering guided projectile */
+	void RegisterGuidance();
+
+	/** [client] take over predicted projectile, visuals start at its location and blend to ours */
+	void ReconcilePredictedProjectile();
+
+	/** how fast visuals blend from predicted projectile location */
+	UPROPERTY(EditDefaultsOnly, Category=Projectile)
+	float PredictionBlendSpeed;
+
+	/** [client] offset of visuals from projectile location */
+	FVector PredictionVisualOffset;
+
+	/** [client] pool generation a predicted projectile was taken over for, INDEX_NONE before the first one */
+	int32 ReconciledGeneration;
+
 	/** trigger explosion */
-	void Explode(const FHitResult& Impact);
+	void Explode(const FHitResult& Impact, EPhysicalSurface SurfaceType);
 
 	/** shutdown projectile and prepare for destruction */
 	void DisableAndDestroy();
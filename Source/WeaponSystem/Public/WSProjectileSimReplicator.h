@@ -0,0 +1,31 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "WSWeapon_Projectile.h"
+#include "WSProjectileSimReplicator.generated.h"
+
+/**
+ * Always relevant channel for simulated projectiles.
+ * Spawned by projectile sim subsystem on server, sends spawn and explosion records batched per tick
+ * so clients see projectiles of weapons that are not relevant to them.
+ */
+UCLASS(NotBlueprintable, NotPlaceable, Transient)
+class WEAPONSYSTEM_API AWSProjectileSimReplicator : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	AWSProjectileSimReplicator();
+
+	/** [all] start simulating projectiles spawned on server */
+	UFUNCTION(unreliable, NetMulticast)
+	void MulticastSpawnProjectiles(const TArray<FProjectileSpawnRecord>& SpawnRecords);
+
+	/** [all] explode simulated projectiles, reliable since clients don't explode projectiles on their own */
+	UFUNCTION(reliable, NetMulticast)
+	void MulticastExplodeProjectiles(const TArray<FProjectileExplosionRecord>& Explosions);
+};
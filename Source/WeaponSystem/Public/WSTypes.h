@@ -56,6 +56,55 @@ struct FDecalData
 	}
 };
 
+/** quantization helpers for compact net structs */
+struct WEAPONSYSTEM_API FWSNetQuantize
+{
+	/** encode unit vector with octahedral mapping, result uses 2 * BitsPerComponent bits */
+	static uint32 EncodeOctahedralNormal(const FVector& Normal, int32 BitsPerComponent);
+
+	/** decode unit vector encoded with EncodeOctahedralNormal */
+	static FVector DecodeOctahedralNormal(uint32 Packed, int32 BitsPerComponent);
+};
+
+/**
+ * Counter based random numbers: every value is a pure hash of (seed, counter).
+ * Stateless and thread safe, any value of the sequence can be computed on its own on client and server.
+ */
+struct FWSShotRandom
+{
+	/** hash of seed and counter */
+	static FORCEINLINE uint32 Hash(uint32 Seed, uint32 Counter)
+	{
+		uint32 Bits = Counter * 0xB5297A4Du;
+		Bits += Seed;
+		Bits ^= Bits >> 8;
+		Bits += 0x68E31DA4u;
+		Bits ^= Bits << 8;
+		Bits *= 0x1B56C4E9u;
+		Bits ^= Bits >> 8;
+		return Bits;
+	}
+
+	/** random number in [0, 1) */
+	static FORCEINLINE float GetFraction(uint32 Seed, uint32 Counter)
+	{
+		return (Hash(Seed, Counter) >> 8) * (1.0f / 16777216.0f);
+	}
+
+	/** uniformly distributed direction inside the cone, uses counters 2 * Index and 2 * Index + 1 */
+	static FVector VRandCone(const FVector& Dir, float ConeHalfAngleRad, uint32 Seed, uint32 Index)
+	{
+		const float CosTheta = FMath::Lerp(1.0f, FMath::Cos(ConeHalfAngleRad), GetFraction(Seed, Index * 2));
+		const float SinTheta = FMath::Sqrt(FMath::Max(0.0f, 1.0f - CosTheta * CosTheta));
+		const float Phi = 2.0f * PI * GetFraction(Seed, Index * 2 + 1);
+
+		FVector AxisY, AxisZ;
+		Dir.FindBestAxisVectors(AxisY, AxisZ);
+
+		return (Dir * CosTheta + (AxisY * FMath::Cos(Phi) + AxisZ * FMath::Sin(Phi)) * SinTheta).GetSafeNormal();
+	}
+};
+
 /** replicated information on a hit we've taken */
 USTRUCT()
 struct FTakeHitInfo
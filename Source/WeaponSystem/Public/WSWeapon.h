@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "WSWeaponSimCore.h"
+#include "Subsystems/WSWeaponTimerSubsystem.h"
 #include "WSWeapon.generated.h"
 
 class USoundCue;
@@ -225,6 +227,22 @@ protected:
 	UPROPERTY(Config)
 	bool bAllowAutomaticWeaponCatchup = true;
 
+	/** max shots fired in one fire update when weapon fires faster than the frame rate, older due shots are dropped */
+	UPROPERTY(Config)
+	int32 MaxShotsPerFireUpdate = 8;
+
+	/** time between shot count acknowledgements client sends to server during burst (seconds) */
+	UPROPERTY(Config)
+	float BurstAckInterval = 0.1f;
+
+	/** server accepts burst start this far in the past, older starts are clamped (seconds) */
+	UPROPERTY(Config)
+	float MaxBurstStartAge = 0.5f;
+
+	/** server allows shots this early for client clock error when rebuilding burst schedule (seconds) */
+	UPROPERTY(Config)
+	float BurstScheduleTolerance = 0.05f;
+
 	/** The weapon component attached to a Pawn */
 	UPROPERTY(BlueprintReadWrite, Transient, ReplicatedUsing=OnRep_WeaponComponent, Category="WeaponSystem|Weapon")
 	TObjectPtr<UWSWeaponComponent> WeaponComponent;
@@ -242,6 +260,12 @@ protected:
 	/** current weapon state */
 	UPROPERTY(BlueprintReadWrite, VisibleInstanceOnly, Category="WeaponSystem|Weapon")
 	EWeaponState CurrentState;
+
+	/** firing, ammo and state rules, settings are taken from weapon config */
+	FWeaponSimCore SimCore;
+
+	/** weapon state and owner inputs for sim core */
+	FWeaponSimState GetSimState() const;
 	
 	/** current total ammo */
 	UPROPERTY(BlueprintReadWrite, Transient, Replicated, Category="WeaponSystem|Weapon")
@@ -283,21 +307,62 @@ protected:
 	/** how much time weapon needs to be equipped */
 	float EquipDuration;
 	
-	/** Adjustment to handle frame rate affecting actual timer interval. */
-	UPROPERTY(Transient)
-	float TimerIntervalAdjustment;
+	/** time when the next shot of the burst is due */
+	float NextShotTime;
+
+	/** time when the shot being fired was due, shots fired together in one update keep their own times */
+	float CurrentShotTime;
+
+	/** where the shot being fired is between the previous fire update (0) and now (1) */
+	float CurrentShotAlpha;
+
+	/** time of the previous fire update */
+	float LastFireUpdateTime;
+
+	/** muzzle at the previous fire update, muzzle of shots due before now is interpolated from it */
+	FTransform LastMuzzleTransform;
+
+	/** [local] id of the current burst, [server] id of the burst being reconciled */
+	uint8 BurstId;
+
+	/** [local] shots fired in the current burst, zero when no burst is reported */
+	int32 LocalBurstShots;
+
+	/** [local] time of the last shot count acknowledgement */
+	float LastBurstAckTime;
+
+	/** [server] burst reported by client is being reconciled */
+	bool bServerBurstActive;
+
+	/** [server] shots of the burst reconciled so far */
+	int32 ServerBurstShots;
+
+	/** [server] server time of the first shot of the burst */
+	double ServerBurstStartTime;
+
+	/** [server] server time of the last reconciled shot */
+	double LastReconciledShotTime;
+
+	/** [server] index of the last shot of the burst client sent shot data for */
+	int32 ServerLastReportedShot;
 	
 	/** Handle for efficient management of OnEquipFinished timer */
-	FTimerHandle TimerHandle_OnEquipFinished;
+	FWSWeaponTimerHandle TimerHandle_OnEquipFinished;
 
 	/** Handle for efficient management of StopReload timer */
-	FTimerHandle TimerHandle_StopReload;
+	FWSWeaponTimerHandle TimerHandle_StopReload;
 
 	/** Handle for efficient management of ReloadWeapon timer */
-	FTimerHandle TimerHandle_ReloadWeapon;
+	FWSWeaponTimerHandle TimerHandle_ReloadWeapon;
 
 	/** Handle for efficient management of HandleFiring timer */
-	FTimerHandle TimerHandle_HandleFiring;
+	FWSWeaponTimerHandle TimerHandle_HandleFiring;
+
+	/** call weapon function after delay on world weapon timers, replaces timer of handle */
+	void SetWeaponTimer(FWSWeaponTimerHandle& Handle, FWSWeaponTimerFunc Func, float Rate);
+
+	/** stop weapon timer */
+	void ClearWeaponTimer(FWSWeaponTimerHandle& Handle);
 
 //----------------------------------------------------------------------------------------------------------------------
 // Sound
@@ -429,16 +494,59 @@ public:
 	/** check if weapon can fire */
 	bool CanFire() const;
 
-	/** [server] fire & update ammo */
+	/** [server] client fired the first shot of a burst */
+	UFUNCTION(reliable, server, WithValidation)
+	void ServerStartBurst(uint8 InBurstId, double StartTime);
+
+	/** [server] client acknowledges number of shots fired in the burst so far */
+	UFUNCTION(unreliable, server, WithValidation)
+	void ServerAckBurst(uint8 InBurstId, uint16 ShotCount);
+
+	/** [server] client finished the burst with total number of shots */
 	UFUNCTION(reliable, server, WithValidation)
-    void ServerHandleFiring();
+	void ServerEndBurst(uint8 InBurstId, uint16 ShotCount);
+
+	/** [server] fire & update ammo for shots of the burst allowed by the schedule rebuilt from its start time */
+	void ReconcileBurst(uint8 InBurstId, int32 ShotCount);
+
+	/** [server] check client shot data is for a shot reconciled in the burst, each shot is accepted once */
+	bool ConsumeBurstShotReport(uint8 InBurstId, int32 ShotIndex);
+
+	/** [local] report fired shot, first shot starts the burst on server */
+	void ReportBurstShot();
 
-	/** [local + server] handle weapon refire, compensating for slack time if the timer can't sample fast enough */
+	/** [local] send shot count of the burst together with batched shot data */
+	void SendBurstAck();
+
+	/** [local] send shot data collected during the burst, called with every acknowledgement and at burst end */
+	virtual void FlushBurstBatch() {}
+
+	/** [local] is the current burst being reported to server */
+	bool IsReportingBurst() const { return LocalBurstShots > 0; }
+
+	/** is weapon controlled by this client and shots have to be reported to server */
+	bool IsLocallyControlledClient() const;
+
+	/** [local + server] handle weapon refire, fires every shot that became due since the previous fire update */
 	void HandleReFiring();
 
 	/** [local + server] handle weapon fire */
 	void HandleFiring();
 
+	/**
+	* [local + server] fire shots due in this update and schedule the next update
+	*
+	* @param NumShots	Number of shots due, starting from NextShotTime
+	*/
+	void FireShots(int32 NumShots);
+
+	/**
+	* [local + server] fire single shot or handle empty clip
+	*
+	* @return true if shot was fired
+	*/
+	bool FireShot();
+
 	/** [local + server] firing started */
 	virtual void OnBurstStarted();
 
@@ -512,6 +620,18 @@ public:
 	/** get direction of weapon's muzzle */
 	FVector GetMuzzleDirection() const;
 
+	/** how long ago the shot being fired was due, zero for shots due right now */
+	float GetShotTimeOffset() const;
+
+	/** server time when the shot being fired was due, double keeps sub-frame precision in long matches */
+	double GetShotServerTime() const;
+
+	/** server world time, estimated on clients */
+	double GetServerWorldTime() const;
+
+	/** get query params for weapon traces */
+	FCollisionQueryParams GetWeaponTraceParams() const;
+
 	/** find hit */
 	FHitResult WeaponTrace(const FVector& TraceFrom, const FVector& TraceTo) const;
 };
@@ -0,0 +1,142 @@
+// 2021 github.com/EugeneTel/WeaponSystem
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** weapon state of simulation, keep in sync with EWeaponState */
+enum class EWeaponSimState : uint8
+{
+	Idle,
+	Firing,
+	Reloading,
+	Equipping,
+
+	Num
+};
+
+/** events caused by state transition */
+enum class EWeaponSimEvent : uint8
+{
+	None = 0,
+	BurstStarted = 1 << 0,
+	BurstFinished = 1 << 1,
+};
+ENUM_CLASS_FLAGS(EWeaponSimEvent);
+
+/** weapon settings used by simulation */
+struct FWeaponSimConfig
+{
+	int32 AmmoPerClip = 20;
+	int32 MaxAmmo = 100;
+	float TimeBetweenShots = 0.2f;
+
+	/** fire all shots due since the previous update when refire can't keep up */
+	bool bAllowCatchup = true;
+
+	/** max shots fired in one update */
+	int32 MaxShotsPerUpdate = 8;
+
+	/** reload duration of headless simulation, actor uses animation length */
+	float ReloadDuration = 1.0f;
+
+	/** step of headless simulation (seconds) */
+	float FixedStep = 1.0f / 60.0f;
+};
+
+/** weapon state and inputs from owner */
+struct FWeaponSimState
+{
+	EWeaponSimState State = EWeaponSimState::Idle;
+
+	int32 Ammo = 0;
+	int32 AmmoInClip = 0;
+
+	bool bIsEquipped = false;
+	bool bPendingEquip = false;
+	bool bPendingReload = false;
+	bool bWantsToFire = false;
+
+	/** owner allows firing and reloading */
+	bool bOwnerCanFire = true;
+	bool bOwnerCanReload = true;
+
+	/** infinite ammo and clip including owner's cheats */
+	bool bInfiniteAmmo = false;
+	bool bInfiniteClip = false;
+
+	/** time when the next shot of the burst is due */
+	double NextShotTime = 0.0;
+
+	/** time of last successful shot */
+	double LastFireTime = 0.0;
+
+	/** headless simulation time, unsimulated remainder of the step and reload end */
+	double Time = 0.0;
+	double PendingTime = 0.0;
+	double ReloadEndTime = 0.0;
+};
+
+/**
+ * Firing, ammo and state rules of weapon without world, actor or timers.
+ * AWSWeapon passes its state in and drives timing with weapon timers, Simulate steps the same rules at fixed rate
+ * so weapons can be simulated and measured headless.
+ * Next state is looked up from a table by state conditions, transition events from a table by previous and new state.
+ */
+struct WEAPONSYSTEM_API FWeaponSimCore
+{
+	FWeaponSimConfig Config;
+
+	/** state weapon should be in */
+	EWeaponSimState DetermineState(const FWeaponSimState& State) const;
+
+	/** switch state, returns burst events caused by transition */
+	EWeaponSimEvent SetState(FWeaponSimState& State, EWeaponSimState NewState) const;
+
+	/** burst events of transition */
+	static EWeaponSimEvent GetTransitionEvents(EWeaponSimState PrevState, EWeaponSimState NewState);
+
+	/** state allows firing, ammo is not checked */
+	bool CanFire(const FWeaponSimState& State) const;
+
+	/** state allows firing and clip has a round */
+	bool CanFireShot(const FWeaponSimState& State) const;
+
+	bool CanReload(const FWeaponSimState& State) const;
+
+	/** consume a round */
+	void UseAmmo(FWeaponSimState& State) const;
+
+	/** move ammo into clip */
+	void ReloadWeapon(FWeaponSimState& State) const;
+
+	/**
+	* add ammo up to max ammo
+	*
+	* @return ammo added
+	*/
+	int32 GiveAmmo(FWeaponSimState& State, int32 AddAmount) const;
+
+	/**
+	* number of shots due at time, moves next shot time past shots dropped by the update limit
+	*
+	* @param State	Weapon state, next shot time is updated
+	* @param Now	Current time
+	*/
+	int32 GetDueShots(FWeaponSimState& State, double Now) const;
+
+	/**
+	* advance headless simulation by fixed steps, remainder is kept for the next call
+	*
+	* @return number of shots fired
+	*/
+	int32 Simulate(FWeaponSimState& State, float DeltaTime) const;
+
+private:
+
+	/** one fixed step of headless simulation */
+	int32 Step(FWeaponSimState& State) const;
+
+	/** start headless reload */
+	void StartReload(FWeaponSimState& State) const;
+};
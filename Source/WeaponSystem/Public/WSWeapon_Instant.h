@@ -4,9 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "WSWeapon.h"
+#include "Subsystems/WSTraceSubsystem.h"
+#include "Net/Serialization/FastArraySerializer.h"
 #include "WSWeapon_Instant.generated.h"
 
 class AWSImpactEffect;
+class AWSWeapon_Instant;
 
 USTRUCT(BlueprintType)
 struct FInstantHitInfo
@@ -23,6 +26,183 @@ struct FInstantHitInfo
 	int32 RandomSeed;
 };
 
+/** single shot in replicated shot history */
+USTRUCT()
+struct FInstantShotItem : public FFastArraySerializerItem
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** shot order, starts from 1 */
+	UPROPERTY()
+	int32 Sequence;
+
+	UPROPERTY()
+	FInstantHitInfo Shot;
+
+	FInstantShotItem():
+	Sequence(0)
+	{
+	}
+};
+
+/**
+ * Ring buffer of the latest shots, delta serialized as fast array.
+ * All shots fired since the last net update are delivered together and replayed in order.
+ */
+USTRUCT()
+struct FInstantShotHistory : public FFastArraySerializer
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** max number of shots delivered in one update */
+	static constexpr int32 Capacity = 8;
+
+	/** [server] add shot, overwrites the oldest one when history is full */
+	void AddShot(const FInstantHitInfo& Shot);
+
+	// FFastArraySerializer contract
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInstantShotItem, FInstantShotHistory>(Items, DeltaParms, *this);
+	}
+
+	/** weapon which replays received shots */
+	UPROPERTY(NotReplicated)
+	TObjectPtr<AWSWeapon_Instant> Owner;
+
+private:
+
+	UPROPERTY()
+	TArray<FInstantShotItem> Items;
+
+	/** [server] sequence of the last added shot */
+	int32 LastSequence = 0;
+
+	/** [client] sequence of the last replayed shot */
+	int32 LastReplayedSequence = 0;
+};
+
+template<>
+struct TStructOpsTypeTraits<FInstantShotHistory> : public TStructOpsTypeTraitsBase2<FInstantShotHistory>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ * Hit of a single pellet, sent to server for verification.
+ * Serialized as a compact payload instead of a full FHitResult, about 18 bytes for a hit on an actor:
+ * quantized positions (0.1 cm), octahedral normal, actor net GUID, bone index and physical surface.
+ */
+USTRUCT()
+struct FInstantPelletHit
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** index of the pellet in the shot spread */
+	uint8 PelletIndex;
+
+	/** was there a blocking hit */
+	bool bBlockingHit;
+
+	/** hit actor */
+	TWeakObjectPtr<AActor> Actor;
+
+	/** hit location */
+	FVector Location;
+
+	/** impact point, same as location for line traces */
+	FVector ImpactPoint;
+
+	/** impact normal */
+	FVector ImpactNormal;
+
+	/** hit bone index in actor's skinned mesh */
+	int16 BoneIndex;
+
+	/** hit physical surface */
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
+	FInstantPelletHit():
+	PelletIndex(0),
+	bBlockingHit(false),
+	Location(ForceInitToZero),
+	ImpactPoint(ForceInitToZero),
+	ImpactNormal(ForceInitToZero),
+	BoneIndex(INDEX_NONE),
+	SurfaceType(SurfaceType_Default)
+	{
+	}
+
+	FInstantPelletHit(uint8 InPelletIndex, const FHitResult& Impact);
+
+	/** rebuild hit result for the pellet trace */
+	void ToHitResult(const FVector& TraceStart, const FVector& TraceEnd, FHitResult& OutImpact) const;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FInstantPelletHit> : public TStructOpsTypeTraitsBase2<FInstantPelletHit>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/** pellet hits of one shot, sent to server in batches with burst acknowledgements */
+USTRUCT()
+struct FInstantShotReport
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TArray<FInstantPelletHit> Hits;
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal AimDir;
+
+	/** checked against spread of the shot index, seed is derived by server from seed base, burst and shot index */
+	UPROPERTY()
+	float ReticleSpread;
+
+	/** shot timestamp in server time for lag compensation */
+	UPROPERTY()
+	double ShotTime;
+
+	/** burst the shot was fired in */
+	UPROPERTY()
+	uint8 BurstId;
+
+	/** index of the shot in the burst, server accepts data only for shots it reconciled */
+	UPROPERTY()
+	uint16 ShotIndex;
+
+	/** max shots in one batch, batch is sent early when full */
+	static constexpr int32 MaxBatchSize = 32;
+
+	FInstantShotReport():
+	Origin(ForceInitToZero),
+	AimDir(ForceInitToZero),
+	ReticleSpread(0.0f),
+	ShotTime(0.0),
+	BurstId(0),
+	ShotIndex(0)
+	{
+	}
+};
+
+/** shoot directions of all pellets in one shot */
+using FInstantShootDirections = TArray<FVector, TInlineAllocator<8>>;
+
 USTRUCT(BlueprintType)
 struct FInstantWeaponData
 {
@@ -44,11 +224,15 @@ struct FInstantWeaponData
 	UPROPERTY(EditDefaultsOnly, Category=Accuracy)
 	float FiringSpreadMax;
 
+	/** number of pellets fired per shot, all pellets are spread inside the current spread cone */
+	UPROPERTY(EditDefaultsOnly, Category=Accuracy, meta=(ClampMin="1", ClampMax="32"))
+	int32 PelletCount;
+
 	/** weapon range */
 	UPROPERTY(EditDefaultsOnly, Category=WeaponStat)
 	float WeaponRange;
 
-	/** damage amount */
+	/** damage amount (per pellet) */
 	UPROPERTY(EditDefaultsOnly, Category=WeaponStat)
 	int32 HitDamage;
 
@@ -60,21 +244,61 @@ struct FInstantWeaponData
 	UPROPERTY(EditDefaultsOnly, Category=HitVerification)
 	float ClientSideHitLeeway;
 
-	/** hit verification: threshold for dot product between view direction and hit direction */
+	/** hit verification: threshold for dot product between view direction and aim direction */
 	UPROPERTY(EditDefaultsOnly, Category=HitVerification)
 	float AllowedViewDotHitDir;
 
+	/** hit verification: max distance between client shot origin and server damage start location (cm) */
+	UPROPERTY(EditDefaultsOnly, Category=HitVerification)
+	float AllowedOriginOffset;
+
+	/** hit verification: max distance of reported impact from the pellet ray derived from the seed (cm) */
+	UPROPERTY(EditDefaultsOnly, Category=HitVerification)
+	float AllowedHitOffset;
+
+	/** hit verification: max difference of client spread from spread of the shot index in the burst (degrees) */
+	UPROPERTY(EditDefaultsOnly, Category=HitVerification)
+	float AllowedSpreadOffset;
+
+	/** hit verification: validate hits on moving actors against lag compensated hitbox history */
+	UPROPERTY(EditDefaultsOnly, Category=HitVerification)
+	bool bUseLagCompensation;
+
+	/** hit verification: expansion of lag compensated hitbox (cm) */
+	UPROPERTY(EditDefaultsOnly, Category=HitVerification, meta=(EditCondition="bUseLagCompensation"))
+	float LagCompensationTolerance;
+
+	/** run hit traces through async batch, hits are processed on the next frame */
+	UPROPERTY(EditDefaultsOnly, Category=Trace)
+	bool bUseAsyncTrace;
+
 	/** defaults */
 	FInstantWeaponData():
 	WeaponSpread(5.0f),
 	TargetingSpreadMod(0.25f),
 	FiringSpreadIncrement(1.0f),
 	FiringSpreadMax(10.0f),
+	PelletCount(1),
 	WeaponRange(10000.0f),
 	HitDamage(10),
 	ClientSideHitLeeway(200.0f),
-	AllowedViewDotHitDir(0.8f)
+	AllowedViewDotHitDir(0.8f),
+	AllowedOriginOffset(200.0f),
+	AllowedHitOffset(10.0f),
+	AllowedSpreadOffset(0.1f),
+	bUseLagCompensation(true),
+	LagCompensationTolerance(30.0f),
+	bUseAsyncTrace(false)
+	{
+	}
+
+	/** max pellets per shot, pellet index is sent with 5 bits */
+	static constexpr int32 MaxPelletCount = 32;
+
+	/** get number of pellets per shot */
+	int32 GetPelletCount() const
 	{
+		return FMath::Clamp(PelletCount, 1, MaxPelletCount);
 	}
 };
 
@@ -88,11 +312,34 @@ class WEAPONSYSTEM_API AWSWeapon_Instant : public AWSWeapon
 
 	AWSWeapon_Instant();
 
+public:
+
+	/**
+	* seed of shot reported to server, depends only on values client and server agree on
+	*
+	* @param SeedBase		Seed base assigned by server
+	* @param InBurstId		Burst id sent with burst start and shot report
+	* @param ShotIndex		Index of the shot in the burst
+	*/
+	static int32 MakeShotSeed(int32 SeedBase, uint8 InBurstId, int32 ShotIndex);
+
+private:
+
 	/** get current spread */
 	float GetCurrentSpread() const;
 
+	/** get spread of shot at index of the burst without targeting modifier */
+	float GetBurstShotSpread(int32 ShotIndex) const;
+
+	/** get seed of shot reported to server from the replicated seed base */
+	int32 GetBurstShotSeed(uint8 InBurstId, int32 ShotIndex) const;
+
 protected:
 
+	virtual void BeginPlay() override;
+	virtual void PostInitializeComponents() override;
+	virtual void OnEnterInventory(UWSWeaponComponent* InWeaponComponent) override;
+
 	/** weapon config */
 	UPROPERTY(EditDefaultsOnly, Category="WeaponSystem")
 	FInstantWeaponData InstantConfig;
@@ -110,31 +357,59 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category="WeaponSystem|Effects")
 	FName TrailTargetParam;
 
-	/** instant hit notify for replication */
-	UPROPERTY(Transient, ReplicatedUsing=OnRep_HitNotify)
-	FInstantHitInfo HitNotify;
+	/** latest shots for replication */
+	UPROPERTY(Transient, Replicated)
+	FInstantShotHistory ShotHistory;
+
+	/** random base of reported shot seeds, assigned by server for every owner so client can't choose the spread */
+	UPROPERTY(Transient, Replicated)
+	int32 ShotSeedBase;
 
 	/** current spread from continuous firing */
 	float CurrentFiringSpread;
 
+	/** [local] number of fired shots, mixed into shot seeds */
+	uint32 ShotCounter;
+
+	/** [local] shots with hits or misses waiting for the next burst batch */
+	TArray<FInstantShotReport> PendingShotReports;
+
+	/** [server] server time the last burst finished, hits of its last shots can arrive after it */
+	double LastBurstEndTime;
+
 
 //----------------------------------------------------------------------------------------------------------------------
 // Weapon usage
 //----------------------------------------------------------------------------------------------------------------------
 
-	/** server notified of hit from client to verify */
+	/** server notified of pellet hits and misses of shots fired since the previous batch from client to verify */
 	UFUNCTION(reliable, server, WithValidation)
-    void ServerNotifyHit(const FHitResult& Impact, FVector_NetQuantizeNormal ShootDir, int32 RandomSeed, float ReticleSpread);
+    void ServerNotifyHits(const TArray<FInstantShotReport>& Shots);
 
-	/** server notified of miss to show trail FX */
-	UFUNCTION(unreliable, server, WithValidation)
-    void ServerNotifyMiss(FVector_NetQuantizeNormal ShootDir, int32 RandomSeed, float ReticleSpread);
+	/** [server] verify pellet hits of one shot reported by client */
+	void ProcessClientShotReport(const FInstantShotReport& Shot);
 
-	/** process the instant hit and notify the server if necessary */
-	void ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 RandomSeed, float ReticleSpread);
+	/** [local] send shots collected during the burst */
+	virtual void FlushBurstBatch() override;
+
+	/** process hits of all pellets and notify the server if necessary, burst id and shot index identify the shot to server */
+	void ProcessInstantShot(TConstArrayView<FHitResult> Impacts, const FVector& Origin, const FVector& AimDir, int32 RandomSeed, float ReticleSpread, double ShotTime,
+		uint8 ShotBurstId, int32 ShotIndex);
 
 	/** continue processing the instant hit, as if it has been confirmed by the server */
-	void ProcessInstantHit_Confirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 RandomSeed, float ReticleSpread);
+	void ProcessInstantHit_Confirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, EPhysicalSurface SurfaceType = SurfaceType_Default);
+
+	/** [server] check client shot origin, aim and spread against server state */
+	bool IsClientShotValid(const FVector& Origin, const FVector& AimDir, float ReticleSpread, double ShotTime, int32 ShotIndex) const;
+
+	/** [server] check client side hit of the pellet shot in direction re-derived from the seed */
+	bool IsClientHitValid(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, double ShotTime) const;
+
+	/** [server] check client side hit on moving actor, falls back to current bounding box if there is no hitbox history */
+	bool IsClientHitOnActorValid(const FHitResult& Impact, const FVector& Origin, double ShotTime) const;
+
+	/** [server] add shot to history, remote clients will simulate the shot */
+	void ReplicateShot(const FVector& Origin, int32 RandomSeed, float ReticleSpread);
 
 	/** check if weapon should deal damage to actor */
 	bool ShouldDealDamage(AActor* InActor) const;
@@ -145,6 +420,19 @@ protected:
 	/** [local] weapon specific fire implementation */
 	virtual void FireWeapon() override;
 
+	/** fire traces finished, process the hits */
+	void OnFireTraceCompleted(TConstArrayView<FHitResult> Impacts, FVector Origin, FVector AimDir, int32 RandomSeed, float ReticleSpread, double ShotTime,
+		uint8 ShotBurstId, int32 ShotIndex);
+
+	/** get pellet directions of the shot, spread is fully defined by the seed */
+	void GetShootDirections(const FVector& AimDir, int32 RandomSeed, float ReticleSpread, FInstantShootDirections& OutDirections) const;
+
+	/** trace all pellets of the shot as one batch */
+	void TraceShot(const FVector& Origin, const FVector& AimDir, int32 RandomSeed, float ReticleSpread, FWSTraceBatchResultDelegate&& OnComplete);
+
+	/** get trace batch if weapon is configured for async traces */
+	UWSTraceSubsystem* GetAsyncTraceSubsystem() const;
+
 	/** [local + server] update spread on firing */
 	virtual void OnBurstFinished() override;
 
@@ -153,14 +441,16 @@ protected:
 // Effects replication
 //----------------------------------------------------------------------------------------------------------------------
 	
-	UFUNCTION()
-    void OnRep_HitNotify();
+	friend struct FInstantShotHistory;
 
 	/** called in network play to do the cosmetic fx  */
 	void SimulateInstantHit(const FVector& Origin, int32 RandomSeed, float ReticleSpread);
 
-	/** spawn effects for impact */
-	void SpawnImpactEffects(const FHitResult& Impact);
+	/** cosmetic traces finished, spawn the fx */
+	void OnSimulateTraceCompleted(TConstArrayView<FHitResult> Impacts);
+
+	/** spawn effects for impact, surface type is used when impact has no physical material */
+	void SpawnImpactEffects(const FHitResult& Impact, EPhysicalSurface SurfaceType = SurfaceType_Default);
 
 	/** spawn trail effect */
 	void SpawnTrailEffect(const FVector& EndPoint);
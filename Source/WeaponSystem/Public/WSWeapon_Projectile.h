@@ -8,6 +8,17 @@
 
 class AWSProjectile;
 
+/**
+ *	Projectile guidance
+ */
+UENUM(BlueprintType, Category="WeaponSystem|Weapon")
+enum class EProjectileGuidance: uint8
+{
+	EPG_None UMETA(DisplayName = "None"),
+	EPG_Guided UMETA(DisplayName = "Guided"),
+	EPG_Homing UMETA(DisplayName = "Homing"),
+};
+
 USTRUCT(BlueprintType)
 struct FProjectileWeaponData
 {
@@ -33,11 +44,160 @@ struct FProjectileWeaponData
 	UPROPERTY(EditDefaultsOnly, Category=WeaponStat)
 	TSubclassOf<UDamageType> DamageType;
 
+	/** simulate projectiles without actors, for weapons firing many projectiles, not used by guided projectiles */
+	UPROPERTY(EditDefaultsOnly, Category=Projectile)
+	bool bUseProjectileSim;
+
+	/** owning client shows projectile immediately and blends it into the replicated one */
+	UPROPERTY(EditDefaultsOnly, Category=Projectile)
+	bool bPredictProjectile;
+
+	/** guided projectiles steer to the shooter aim, homing projectiles lock on targets in front of them */
+	UPROPERTY(EditDefaultsOnly, Category=Guidance)
+	EProjectileGuidance Guidance;
+
+	/** max turn speed of guided projectile (degrees per second) */
+	UPROPERTY(EditDefaultsOnly, Category=Guidance, meta=(EditCondition="Guidance != EProjectileGuidance::EPG_None"))
+	float GuidanceTurnRate;
+
+	/** distance of the aim point guided projectile steers to */
+	UPROPERTY(EditDefaultsOnly, Category=Guidance, meta=(EditCondition="Guidance == EProjectileGuidance::EPG_Guided"))
+	float GuidanceRange;
+
+	/** max distance to homing target */
+	UPROPERTY(EditDefaultsOnly, Category=Guidance, meta=(EditCondition="Guidance == EProjectileGuidance::EPG_Homing"))
+	float HomingRadius;
+
+	/** half angle of homing seeker cone (degrees) */
+	UPROPERTY(EditDefaultsOnly, Category=Guidance, meta=(EditCondition="Guidance == EProjectileGuidance::EPG_Homing", ClampMin="0", ClampMax="180"))
+	float HomingConeAngle;
+
 	/** defaults */
 	FProjectileWeaponData():
 		ProjectileLife(10.0f),
 		ExplosionDamage(100.0f),
-		ExplosionRadius(300.0f)
+		ExplosionRadius(300.0f),
+		bUseProjectileSim(false),
+		bPredictProjectile(false),
+		Guidance(EProjectileGuidance::EPG_None),
+		GuidanceTurnRate(90.0f),
+		GuidanceRange(10000.0f),
+		HomingRadius(5000.0f),
+		HomingConeAngle(30.0f)
+	{
+	}
+
+	/** are projectiles simulated without actors */
+	bool UsesProjectileSim() const { return bUseProjectileSim && Guidance == EProjectileGuidance::EPG_None; }
+};
+
+/** replicated spawn of simulated projectile, clients simulate it locally from these parameters */
+USTRUCT()
+struct FProjectileSpawnRecord
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal ShootDir;
+
+	/** server world time of spawn */
+	UPROPERTY()
+	double ServerTime;
+
+	/** matches explosion with projectile, unique in the world */
+	UPROPERTY()
+	uint16 ProjectileId;
+
+	/** weapon class the projectile config is built from, weapon itself may be not relevant to the client */
+	UPROPERTY()
+	TSubclassOf<AWSWeapon_Projectile> WeaponClass;
+
+	/** ignored by projectile collision, null if not relevant to the client */
+	UPROPERTY()
+	TObjectPtr<APawn> Instigator;
+
+	FProjectileSpawnRecord():
+		Origin(ForceInitToZero),
+		ShootDir(ForceInitToZero),
+		ServerTime(0.0),
+		ProjectileId(0),
+		Instigator(nullptr)
+	{
+	}
+};
+
+/** replicated projectile explosion, clients spawn explosion effect from it without tracing */
+USTRUCT()
+struct FProjectileExplosionInfo
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** cleared when projectile is reused from the pool */
+	bool bExploded;
+
+	/** impact point */
+	FVector ImpactPoint;
+
+	/** impact normal */
+	FVector ImpactNormal;
+
+	/** hit physical surface */
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
+	FProjectileExplosionInfo():
+		bExploded(false),
+		ImpactPoint(ForceInitToZero),
+		ImpactNormal(ForceInitToZero),
+		SurfaceType(SurfaceType_Default)
+	{
+	}
+
+	explicit FProjectileExplosionInfo(const FHitResult& Impact);
+
+	/** rebuild hit result of the impact */
+	void ToHitResult(FHitResult& OutImpact) const;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FProjectileExplosionInfo& Other) const
+	{
+		return bExploded == Other.bExploded && ImpactPoint == Other.ImpactPoint && ImpactNormal == Other.ImpactNormal && SurfaceType == Other.SurfaceType;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FProjectileExplosionInfo> : public TStructOpsTypeTraitsBase2<FProjectileExplosionInfo>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+/** replicated explosion of simulated projectile */
+USTRUCT()
+struct FProjectileExplosionRecord
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** id from spawn record */
+	UPROPERTY()
+	uint16 ProjectileId;
+
+	/** weapon class for explosion effect, used when spawn record was dropped */
+	UPROPERTY()
+	TSubclassOf<AWSWeapon_Projectile> WeaponClass;
+
+	/** server impact */
+	UPROPERTY()
+	FProjectileExplosionInfo Explosion;
+
+	FProjectileExplosionRecord():
+		ProjectileId(0)
 	{
 	}
 };
@@ -58,12 +218,21 @@ public:
 	/** apply config on projectile */
 	void ApplyWeaponConfig(FProjectileWeaponData& Data);
 
+	/** [local] take the oldest predicted projectile waiting for its replicated one */
+	AWSProjectile* TakePredictedProjectile();
+
 protected:
 
 	/** weapon config */
 	UPROPERTY(EditDefaultsOnly, Category=WeaponSystem)
 	FProjectileWeaponData ProjectileConfig;
 
+	virtual void BeginPlay() override;
+
+	/** max time server projectiles are moved forward to catch up with client prediction (seconds) */
+	UPROPERTY(Config)
+	float MaxPredictionTime = 0.1f;
+
 //----------------------------------------------------------------------------------------------------------------------
 // Weapon usage
 //----------------------------------------------------------------------------------------------------------------------
@@ -71,8 +240,20 @@ protected:
 	/** [local] weapon specific fire implementation */
 	virtual void FireWeapon() override;
 
-	/** spawn projectile on server */
+	/** spawn projectile on server, offset is how long ago the shot was due in milliseconds */
 	UFUNCTION(reliable, server, WithValidation)
-    void ServerFireProjectile(FVector Origin, FVector_NetQuantizeNormal ShootDir);
+    void ServerFireProjectile(FVector Origin, FVector_NetQuantizeNormal ShootDir, uint8 ShotTimeOffsetMs);
+
+	/** [local] spawn projectile visible only to the shooter until the server one arrives */
+	void SpawnPredictedProjectile(const FVector& Origin, const FVector& ShootDir);
+
+	/** [server] how long ago the shot was due, clamped to shots one fire update can fire */
+	float GetClientShotTimeOffset(uint8 ShotTimeOffsetMs) const;
+
+	/** [server] time to move new projectile forward, half of the shooter round trip */
+	float GetPredictionTime() const;
+
+	/** [local] predicted projectiles in fire order */
+	TArray<TWeakObjectPtr<AWSProjectile>> PredictedProjectiles;
 	
 };
@@ -7,6 +7,8 @@
 
 DECLARE_LOG_CATEGORY_EXTERN(LogWeaponSystem, Log, All);
 
+DECLARE_STATS_GROUP(TEXT("WeaponSystem"), STATGROUP_WeaponSystem, STATCAT_Advanced);
+
 // define weapon default collisions if not set
 #ifndef COLLISION_WEAPON
 	#define COLLISION_WEAPON	ECC_GameTraceChannel1
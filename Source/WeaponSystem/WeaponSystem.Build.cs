@@ -25,7 +25,8 @@ public class WeaponSystem : ModuleRules
 		PublicDependencyModuleNames.AddRange(
 			new string[]
 			{
-				"Core"
+				"Core",
+				"NetCore"
 			}
 			);
 			